@@ -0,0 +1,152 @@
+/** @file
+ * Pomiar rozmiaru i czasu zapytań zwięzłej kopii struktury w porównaniu
+ * ze strukturą wskaźnikową. Przyjmuje opcjonalnie liczbę losowych
+ * przekierowań (domyślnie milion) i wypisuje jeden wiersz wyników.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+/** Udostępnia clock_gettime(). */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "phone_forward.h"
+
+#if defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+/** Czy rozmiar sterty można odczytać przez mallinfo2(). */
+#define HAVE_MALLINFO2 1
+#endif
+
+/** Domyślna liczba przekierowań. */
+#define DEFAULT_RULES 1000000
+
+/** Liczba zapytań każdego rodzaju. */
+#define QUERIES 1000000
+
+/** Długość bufora na numer. */
+#define NUMBER_BUFFER 16
+
+/**
+ * @brief Zwraca bieżący czas w sekundach.
+ */
+static double
+now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Zwraca liczbę bajtów zajętych na stercie lub 0, jeśli nie da się
+ * jej odczytać.
+ */
+static size_t
+heapSize(void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Losuje numer z cyfr 0-9.
+ *
+ * @param[out] buf Bufor o rozmiarze co najmniej NUMBER_BUFFER.
+ * @param min Minimalna długość numeru.
+ * @param spread Liczba możliwych długości.
+ */
+static void
+randomNumber(char *buf, int min, int spread)
+{
+	int len = min + rand() % spread;
+	for (int i = 0; i < len; ++i)
+		buf[i] = '0' + rand() % 10;
+	buf[len] = '\0';
+}
+
+/**
+ * Rodzaj mierzonego zapytania.
+ */
+enum Query {
+	POINTER_GET, ///< phfwdGet().
+	SUCCINCT_GET, ///< phfwdSuccinctGet().
+	POINTER_REVERSE, ///< phfwdReverse().
+	SUCCINCT_REVERSE, ///< phfwdSuccinctReverse().
+	QUERY_KINDS ///< Liczba rodzajów zapytań.
+};
+
+/**
+ * @brief Mierzy średni czas zapytania. Zapytania o ten sam rodzaj wyniku
+ * dostają te same numery.
+ *
+ * @param kind Rodzaj zapytania.
+ * @param pf Struktura wskaźnikowa.
+ * @param succinct Zwięzła kopia.
+ * @param[in,out] sum Suma kontrolna wyników.
+ *
+ * @return Czas zapytania w nanosekundach.
+ */
+static double
+measure(enum Query kind, struct PhoneForward *pf,
+        const struct PhoneForwardSuccinct *succinct, size_t *sum)
+{
+	char num[NUMBER_BUFFER];
+	srand(kind < POINTER_REVERSE ? 2 : 3);
+	double start = now();
+	for (int i = 0; i < QUERIES; ++i) {
+		randomNumber(num, 8, 6);
+		const struct PhoneNumbers *res = NULL;
+		switch (kind) {
+		case POINTER_GET: res = phfwdGet(pf, num); break;
+		case SUCCINCT_GET: res = phfwdSuccinctGet(succinct, num); break;
+		case POINTER_REVERSE: res = phfwdReverse(pf, num); break;
+		default: res = phfwdSuccinctReverse(succinct, num); break;
+		}
+		*sum += phnumGet(res, 0)[0];
+		phnumDelete(res);
+	}
+	return (now() - start) * 1e9 / QUERIES;
+}
+
+int main(int argc, char **argv)
+{
+	int rules = argc > 1 ? atoi(argv[1]) : DEFAULT_RULES;
+	struct PhoneForward *pf = phfwdNew();
+	if (rules <= 0 || !pf) return 1;
+	srand(1);
+	size_t before = heapSize();
+	for (int i = 0; i < rules; ++i) {
+		char num1[NUMBER_BUFFER], num2[NUMBER_BUFFER];
+		randomNumber(num1, 6, 6);
+		randomNumber(num2, 6, 6);
+		phfwdAdd(pf, num1, num2);
+	}
+	size_t pointer = heapSize() - before;
+	double start = now();
+	struct PhoneForwardSuccinct *succinct = phfwdSuccinctNew(pf);
+	double build = now() - start;
+	if (!succinct) return 1;
+
+	size_t sum = 0;
+	double time[QUERY_KINDS];
+	for (int kind = 0; kind < QUERY_KINDS; ++kind)
+		time[kind] = measure(kind, pf, succinct, &sum);
+	printf("rules %d | pointer heap %.1f MB, succinct %.1f MB, "
+	       "build %.2f s | get %.0f ns / %.0f ns | "
+	       "reverse %.0f ns / %.0f ns | checksum %zu\n",
+	       rules, pointer / 1e6, phfwdSuccinctSize(succinct) / 1e6, build,
+	       time[POINTER_GET], time[SUCCINCT_GET], time[POINTER_REVERSE],
+	       time[SUCCINCT_REVERSE], sum);
+	phfwdSuccinctDelete(succinct);
+	phfwdDelete(pf);
+	return 0;
+}
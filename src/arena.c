@@ -0,0 +1,181 @@
+/** @file
+ * Implementacja alokatora pamięci przydzielającego małe bloki ze wspólnych
+ * slabów.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "arena.h"
+
+/** Rozmiar pierwszego slabu. Małe bazy nie zajmują dużo pamięci. */
+#define FIRST_SLAB 4096
+
+/** Maksymalny rozmiar slabu. Kolejne slaby rosną dwukrotnie aż do niego. */
+#define MAX_SLAB (1 << 20)
+
+/**
+ * Nagłówek slabu. Bloki są wycinane z pamięci znajdującej się za nim.
+ */
+struct ArenaSlab {
+	struct ArenaSlab *next; ///< Poprzednio zaalokowany slab.
+	size_t pad; ///< Wyrównanie danych za nagłówkiem.
+};
+
+/**
+ * Nagłówek dużego bloku alokowanego osobno.
+ */
+struct ArenaBig {
+	struct ArenaBig *prev; ///< Poprzedni duży blok lub NULL.
+	struct ArenaBig *next; ///< Następny duży blok lub NULL.
+};
+
+/**
+ * @brief Zwraca klasę rozmiaru bloku.
+ *
+ * @param size Rozmiar bloku.
+ *
+ * @return Indeks listy wolnych bloków. Wartość ARENA_CLASSES lub większa
+ * oznacza duży blok.
+ */
+static inline size_t
+sizeClass(size_t size)
+{
+	return size ? (size - 1) / ARENA_GRAIN : 0;
+}
+
+void
+arenaInit(struct Arena *arg)
+{
+	*arg = (struct Arena){NULL, NULL, NULL, FIRST_SLAB, {NULL}, NULL};
+}
+
+/**
+ * @brief Dodaje do alokatora nowy slab.
+ *
+ * @param arg Alokator.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+addSlab(struct Arena *arg)
+{
+	struct ArenaSlab *slab = malloc(arg->nextSlab);
+	if (!slab) return false;
+	slab->next = arg->slabs;
+	arg->slabs = slab;
+	arg->bump = (char*)(slab + 1);
+	arg->end = (char*)slab + arg->nextSlab;
+	if (arg->nextSlab < MAX_SLAB)
+		arg->nextSlab *= 2;
+	return true;
+}
+
+void *
+arenaAlloc(struct Arena *arg, size_t size)
+{
+	size_t class = sizeClass(size);
+	if (class >= ARENA_CLASSES) {
+		struct ArenaBig *big = malloc(sizeof(struct ArenaBig) + size);
+		if (!big) return NULL;
+		big->prev = NULL;
+		big->next = arg->bigs;
+		if (arg->bigs)
+			arg->bigs->prev = big;
+		arg->bigs = big;
+		return big + 1;
+	}
+
+	void *ret = arg->freeLists[class];
+	if (ret) {
+		arg->freeLists[class] = *(void**)ret;
+		return ret;
+	}
+
+	size_t rounded = (class + 1) * ARENA_GRAIN;
+	if ((size_t)(arg->end - arg->bump) < rounded) {
+		/* Resztka slabu przepada; jest mniejsza od największej klasy. */
+		if (!addSlab(arg)) return NULL;
+	}
+	ret = arg->bump;
+	arg->bump += rounded;
+	return ret;
+}
+
+void
+arenaFree(struct Arena *arg, void *ptr, size_t size)
+{
+	if (!ptr)
+		return;
+	size_t class = sizeClass(size);
+	if (class >= ARENA_CLASSES) {
+		struct ArenaBig *big = (struct ArenaBig*)ptr - 1;
+		if (big->prev)
+			big->prev->next = big->next;
+		else
+			arg->bigs = big->next;
+		if (big->next)
+			big->next->prev = big->prev;
+		free(big);
+		return;
+	}
+	*(void**)ptr = arg->freeLists[class];
+	arg->freeLists[class] = ptr;
+}
+
+void
+arenaClear(struct Arena *arg)
+{
+	while (arg->slabs) {
+		struct ArenaSlab *tmp = arg->slabs->next;
+		free(arg->slabs);
+		arg->slabs = tmp;
+	}
+	while (arg->bigs) {
+		struct ArenaBig *tmp = arg->bigs->next;
+		free(arg->bigs);
+		arg->bigs = tmp;
+	}
+	arenaInit(arg);
+}
+
+void
+arenaMerge(struct Arena *dst, struct Arena *src)
+{
+	if (src->slabs) {
+		struct ArenaSlab *tail = src->slabs;
+		while (tail->next)
+			tail = tail->next;
+		if (dst->slabs) {
+			/* Najnowszym slabem zostaje slab dst, więc resztka slabu src
+			 * przepada. */
+			tail->next = dst->slabs->next;
+			dst->slabs->next = src->slabs;
+		} else {
+			dst->slabs = src->slabs;
+			dst->bump = src->bump;
+			dst->end = src->end;
+			dst->nextSlab = src->nextSlab;
+		}
+	}
+	for (size_t i = 0; i < ARENA_CLASSES; ++i) {
+		void **tail = &src->freeLists[i];
+		while (*tail)
+			tail = (void**)*tail;
+		*tail = dst->freeLists[i];
+		dst->freeLists[i] = src->freeLists[i];
+	}
+	if (src->bigs) {
+		struct ArenaBig *tail = src->bigs;
+		while (tail->next)
+			tail = tail->next;
+		tail->next = dst->bigs;
+		if (dst->bigs)
+			dst->bigs->prev = tail;
+		dst->bigs = src->bigs;
+	}
+	arenaInit(src);
+}
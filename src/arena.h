@@ -0,0 +1,95 @@
+/** @file
+ * Interfejs alokatora pamięci przydzielającego małe bloki ze wspólnych slabów.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+
+/** Ziarno alokacji. Rozmiar każdego małego bloku jest jego wielokrotnością. */
+#define ARENA_GRAIN 8
+
+/** Liczba klas rozmiarów małych bloków. Większe bloki są alokowane osobno. */
+#define ARENA_CLASSES 32
+
+/**
+ * @brief Alokator przydzielający pamięć z dużych slabów.
+ *
+ * Małe bloki są wycinane ze slabów przez przesunięcie wskaźnika, więc kolejne
+ * alokacje leżą obok siebie w pamięci. Zwolnione małe bloki trafiają na listę
+ * wolnych bloków swojej klasy rozmiaru i są ponownie wykorzystywane. Bloki
+ * większe niż ARENA_CLASSES * ARENA_GRAIN są alokowane przez malloc() i
+ * trzymane na liście, dzięki czemu arenaClear() zwalnia całą pamięć bez
+ * przeglądania struktur, które z niej korzystały.
+ */
+struct Arena {
+	/** Lista zaalokowanych slabów, od najnowszego. */
+	struct ArenaSlab *slabs;
+
+	/** Pierwszy wolny bajt w najnowszym slabie. */
+	char *bump;
+
+	/** Koniec najnowszego slabu. */
+	char *end;
+
+	/** Rozmiar następnego alokowanego slabu. */
+	size_t nextSlab;
+
+	/** Listy wolnych bloków dla poszczególnych klas rozmiarów. */
+	void *freeLists[ARENA_CLASSES];
+
+	/** Lista dużych bloków zaalokowanych osobno. */
+	struct ArenaBig *bigs;
+};
+
+/**
+ * @brief Inicjalizuje pusty alokator.
+ *
+ * @param arg Inicjalizowany alokator.
+ */
+void arenaInit(struct Arena *arg);
+
+/**
+ * @brief Alokuje blok pamięci.
+ *
+ * @param arg Alokator.
+ * @param size Rozmiar bloku w bajtach.
+ *
+ * @return Wskaźnik na blok wyrównany do ARENA_GRAIN lub NULL w przypadku
+ * błędu alokacji.
+ */
+void * arenaAlloc(struct Arena *arg, size_t size);
+
+/**
+ * @brief Zwraca blok do alokatora.
+ * Nic nie robi, jeśli @p ptr ma wartość NULL.
+ *
+ * @param arg Alokator, z którego pochodzi blok.
+ * @param ptr Zwalniany blok.
+ * @param size Rozmiar podany przy alokacji bloku.
+ */
+void arenaFree(struct Arena *arg, void *ptr, size_t size);
+
+/**
+ * @brief Zwalnia całą pamięć zaalokowaną przez alokator.
+ * Po wywołaniu alokator jest pusty i może być dalej używany.
+ *
+ * @param arg Czyszczony alokator.
+ */
+void arenaClear(struct Arena *arg);
+
+/**
+ * @brief Przenosi całą pamięć jednego alokatora do drugiego.
+ * Bloki zaalokowane przez @p src należy odtąd zwalniać przez @p dst.
+ * Po wywołaniu @p src jest pusty i może być dalej używany.
+ *
+ * @param dst Alokator docelowy.
+ * @param src Opróżniany alokator.
+ */
+void arenaMerge(struct Arena *dst, struct Arena *src);
+
+#endif
@@ -0,0 +1,221 @@
+/** @file
+ * Implementacja wektora bitów z operacjami rank i select.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <stdlib.h>
+#include "bitvector.h"
+
+/** Liczba bitów w bloku. */
+#define BLOCK_BITS (64 * BITS_BLOCK_WORDS)
+
+/**
+ * @brief Zwraca liczbę zapalonych bitów słowa.
+ *
+ * @param word Słowo.
+ */
+static inline unsigned
+popcount64(uint64_t word)
+{
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL)
+	       + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (word * 0x0101010101010101ULL) >> 56;
+}
+
+/**
+ * @brief Wyszukuje zapalony bit słowa o danym numerze.
+ *
+ * @param word Słowo.
+ * @param k Numer bitu, licząc od zera; mniejszy niż liczba zapalonych bitów.
+ *
+ * @return Indeks bitu.
+ */
+static unsigned
+selectInWord(uint64_t word, unsigned k)
+{
+	unsigned ret = 0;
+	for (unsigned width = 32; width >= 8; width /= 2) {
+		unsigned low = popcount64(word & (((uint64_t)1 << width) - 1));
+		if (k >= low) {
+			k -= low;
+			word >>= width;
+			ret += width;
+		}
+	}
+	for (; ; word >>= 1, ++ret) {
+		if (word & 1 && k-- == 0)
+			return ret;
+	}
+}
+
+/**
+ * @brief Zwraca liczbę słów wektora.
+ *
+ * @param arg Wektor.
+ */
+static inline size_t
+wordCount(const struct BitVector *arg)
+{
+	return (arg->bits + 63) / 64;
+}
+
+/**
+ * @brief Zwraca słowo wektora z bitami zanegowanymi, jeśli wyszukiwane są
+ * zera. Bity za końcem wektora są zawsze zerami.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks słowa.
+ * @param zeros Czy negować bity.
+ */
+static inline uint64_t
+wordOf(const struct BitVector *arg, size_t idx, bool zeros)
+{
+	uint64_t word = zeros ? ~arg->words[idx] : arg->words[idx];
+	if (idx == arg->bits / 64)
+		word &= ((uint64_t)1 << arg->bits % 64) - 1;
+	return word;
+}
+
+/**
+ * @brief Wyszukuje jedynkę lub zero o danym numerze.
+ *
+ * @param arg Wektor z wyznaczonym katalogiem.
+ * @param k Numer bitu.
+ * @param zeros Czy wyszukiwać zera.
+ *
+ * @return Indeks bitu.
+ */
+static size_t
+selectBit(const struct BitVector *arg, size_t k, bool zeros)
+{
+	size_t lo = 0, hi = (arg->bits + BLOCK_BITS - 1) / BLOCK_BITS;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		size_t before = zeros ? mid * BLOCK_BITS - arg->ranks[mid]
+		                      : arg->ranks[mid];
+		if (before <= k)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	k -= zeros ? lo * BLOCK_BITS - arg->ranks[lo] : arg->ranks[lo];
+	for (size_t w = lo * BITS_BLOCK_WORDS; ; ++w) {
+		uint64_t word = wordOf(arg, w, zeros);
+		unsigned count = popcount64(word);
+		if (k < count)
+			return w * 64 + selectInWord(word, k);
+		k -= count;
+	}
+}
+
+/**
+ * @brief Wyszukuje pierwszą jedynkę lub pierwsze zero nie wcześniej niż na
+ * danej pozycji.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks bitu.
+ * @param zeros Czy wyszukiwać zera.
+ *
+ * @return Indeks bitu lub długość wektora, jeśli takiego nie ma.
+ */
+static size_t
+nextBit(const struct BitVector *arg, size_t idx, bool zeros)
+{
+	if (idx >= arg->bits) return arg->bits;
+	size_t w = idx / 64;
+	uint64_t word = wordOf(arg, w, zeros) & ~(((uint64_t)1 << idx % 64) - 1);
+	while (!word) {
+		if (++w == wordCount(arg)) return arg->bits;
+		word = wordOf(arg, w, zeros);
+	}
+	return w * 64 + popcount64((word & -word) - 1);
+}
+
+bool
+bitsInit(struct BitVector *arg, size_t bits)
+{
+	size_t words = (bits + 63) / 64;
+	*arg = (struct BitVector){calloc(words ? words : 1, sizeof(uint64_t)),
+	                          NULL, bits, 0};
+	return arg->words != NULL;
+}
+
+void
+bitsFree(struct BitVector *arg)
+{
+	free(arg->words);
+	free(arg->ranks);
+	arg->words = arg->ranks = NULL;
+}
+
+bool
+bitsBuild(struct BitVector *arg)
+{
+	size_t blocks = (arg->bits + BLOCK_BITS - 1) / BLOCK_BITS + 1;
+	free(arg->ranks);
+	arg->ranks = malloc(blocks * sizeof(uint64_t));
+	if (!arg->ranks) return false;
+	size_t ones = 0;
+	for (size_t w = 0; w < wordCount(arg); ++w) {
+		if (w % BITS_BLOCK_WORDS == 0)
+			arg->ranks[w / BITS_BLOCK_WORDS] = ones;
+		ones += popcount64(wordOf(arg, w, false));
+	}
+	arg->ranks[blocks - 1] = ones;
+	arg->ones = ones;
+	return true;
+}
+
+size_t
+bitsRank1(const struct BitVector *arg, size_t idx)
+{
+	size_t w = idx / 64;
+	size_t ret = arg->ranks[idx / BLOCK_BITS];
+	for (size_t i = idx / BLOCK_BITS * BITS_BLOCK_WORDS; i < w; ++i)
+		ret += popcount64(arg->words[i]);
+	if (idx % 64)
+		ret += popcount64(arg->words[w] & (((uint64_t)1 << idx % 64) - 1));
+	return ret;
+}
+
+size_t
+bitsRank0(const struct BitVector *arg, size_t idx)
+{
+	return idx - bitsRank1(arg, idx);
+}
+
+size_t
+bitsSelect1(const struct BitVector *arg, size_t k)
+{
+	return selectBit(arg, k, false);
+}
+
+size_t
+bitsSelect0(const struct BitVector *arg, size_t k)
+{
+	return selectBit(arg, k, true);
+}
+
+size_t
+bitsNext1(const struct BitVector *arg, size_t idx)
+{
+	return nextBit(arg, idx, false);
+}
+
+size_t
+bitsNext0(const struct BitVector *arg, size_t idx)
+{
+	return nextBit(arg, idx, true);
+}
+
+size_t
+bitsBytes(const struct BitVector *arg)
+{
+	return wordCount(arg) * sizeof(uint64_t)
+	       + ((arg->bits + BLOCK_BITS - 1) / BLOCK_BITS + 1) * sizeof(uint64_t);
+}
@@ -0,0 +1,152 @@
+/** @file
+ * Interfejs wektora bitów z operacjami rank i select.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef BITVECTOR_H
+#define BITVECTOR_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Liczba słów 64-bitowych w bloku, dla którego pamiętana jest liczba
+ * jedynek przed nim. */
+#define BITS_BLOCK_WORDS 8
+
+/**
+ * @brief Wektor bitów z operacjami rank i select.
+ *
+ * Bity są ustawiane funkcją bitsSet(), po czym bitsBuild() wyznacza liczbę
+ * jedynek przed każdym blokiem BITS_BLOCK_WORDS słów. Rank sumuje licznik
+ * bloku i jedynki w jego słowach, a select wyszukuje blok binarnie.
+ * Narzut katalogu to 64 bity na 512 bitów wektora.
+ */
+struct BitVector {
+	uint64_t *words; ///< Bity, od najmniej znaczącego bitu pierwszego słowa.
+	uint64_t *ranks; ///< Liczba jedynek przed kolejnymi blokami.
+	size_t bits; ///< Długość wektora.
+	size_t ones; ///< Liczba jedynek; ustalana przez bitsBuild().
+};
+
+/**
+ * @brief Tworzy wektor zer o danej długości.
+ *
+ * @param arg Wektor.
+ * @param bits Długość wektora.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+bool bitsInit(struct BitVector *arg, size_t bits);
+
+/**
+ * @brief Zwalnia pamięć wektora.
+ *
+ * @param arg Wektor utworzony przez bitsInit().
+ */
+void bitsFree(struct BitVector *arg);
+
+/**
+ * @brief Ustawia bit na jedynkę.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks bitu.
+ */
+static inline void
+bitsSet(struct BitVector *arg, size_t idx)
+{
+	arg->words[idx / 64] |= (uint64_t)1 << idx % 64;
+}
+
+/**
+ * @brief Zwraca bit wektora.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks bitu.
+ */
+static inline bool
+bitsGet(const struct BitVector *arg, size_t idx)
+{
+	return arg->words[idx / 64] >> idx % 64 & 1;
+}
+
+/**
+ * @brief Wyznacza katalog dla operacji rank i select.
+ * Należy ją wywołać po ustawieniu wszystkich bitów.
+ *
+ * @param arg Wektor.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+bool bitsBuild(struct BitVector *arg);
+
+/**
+ * @brief Zlicza jedynki przed danym bitem.
+ *
+ * @param arg Wektor z wyznaczonym katalogiem.
+ * @param idx Indeks bitu, nie większy niż długość wektora.
+ *
+ * @return Liczba jedynek na pozycjach mniejszych niż @p idx.
+ */
+size_t bitsRank1(const struct BitVector *arg, size_t idx);
+
+/**
+ * @brief Zlicza zera przed danym bitem.
+ *
+ * @param arg Wektor z wyznaczonym katalogiem.
+ * @param idx Indeks bitu, nie większy niż długość wektora.
+ *
+ * @return Liczba zer na pozycjach mniejszych niż @p idx.
+ */
+size_t bitsRank0(const struct BitVector *arg, size_t idx);
+
+/**
+ * @brief Wyszukuje jedynkę o danym numerze.
+ *
+ * @param arg Wektor z wyznaczonym katalogiem.
+ * @param k Numer jedynki, licząc od zera; mniejszy niż liczba jedynek.
+ *
+ * @return Indeks @p k-tej jedynki.
+ */
+size_t bitsSelect1(const struct BitVector *arg, size_t k);
+
+/**
+ * @brief Wyszukuje zero o danym numerze.
+ *
+ * @param arg Wektor z wyznaczonym katalogiem.
+ * @param k Numer zera, licząc od zera; mniejszy niż liczba zer.
+ *
+ * @return Indeks @p k-tego zera.
+ */
+size_t bitsSelect0(const struct BitVector *arg, size_t k);
+
+/**
+ * @brief Wyszukuje pierwszą jedynkę nie wcześniej niż na danej pozycji.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks bitu, nie większy niż długość wektora.
+ *
+ * @return Indeks jedynki lub długość wektora, jeśli takiej nie ma.
+ */
+size_t bitsNext1(const struct BitVector *arg, size_t idx);
+
+/**
+ * @brief Wyszukuje pierwsze zero nie wcześniej niż na danej pozycji.
+ *
+ * @param arg Wektor.
+ * @param idx Indeks bitu, nie większy niż długość wektora.
+ *
+ * @return Indeks zera lub długość wektora, jeśli takiego nie ma.
+ */
+size_t bitsNext0(const struct BitVector *arg, size_t idx);
+
+/**
+ * @brief Zwraca rozmiar pamięci zajmowanej przez bity i katalog.
+ *
+ * @param arg Wektor.
+ */
+size_t bitsBytes(const struct BitVector *arg);
+
+#endif
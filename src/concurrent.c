@@ -0,0 +1,249 @@
+/** @file
+ * Implementacja bazy przekierowań współdzielonej przez wiele wątków.
+ *
+ * Baza składa się z dwóch kopii struktury PhoneForward. Czytelnicy korzystają
+ * z kopii wskazanej przez pole front, a pisarz zmienia drugą kopię, publikuje
+ * ją, czeka, aż starszą kopię opuszczą wszyscy czytelnicy, i powtarza na niej
+ * tę samą zmianę. Dzięki temu wierzchołki zwalniane przez phfwdAdd()
+ * i phfwdRemove() nigdy nie są widoczne dla żadnego czytelnika.
+ *
+ * Obecność czytelników jest śledzona epokami: czytelnik zwiększa licznik
+ * epoki, w której zaczął, a pisarz po opublikowaniu kopii przełącza epokę
+ * i czeka, aż wyzerują się liczniki obu epok po kolei. Liczniki są rozłożone
+ * na osobne linie pamięci podręcznej, żeby czytelnicy z różnych wątków nie
+ * rywalizowali o jedną.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "concurrent.h"
+
+/** Liczba liczników czytelników w każdej epoce. */
+#define READER_STRIPES 64
+
+/** Rozmiar linii pamięci podręcznej. */
+#define CACHE_LINE 64
+
+/**
+ * Licznik czytelników zajmujący osobną linię pamięci podręcznej.
+ */
+struct ReaderSlot {
+	_Alignas(CACHE_LINE) atomic_size_t count; ///< Liczba czytelników.
+};
+
+/**
+ * Baza przekierowań współdzielona przez wiele wątków.
+ */
+struct PhoneForwardShared {
+	/** Liczniki czytelników dla obu epok. */
+	struct ReaderSlot readers[2][READER_STRIPES];
+
+	/** Dwie kopie bazy. */
+	struct PhoneForward *base[2];
+
+	/** Indeks kopii, z której korzystają czytelnicy. */
+	atomic_uint front;
+
+	/** Epoka, w której zaczynają nowi czytelnicy. */
+	atomic_uint epoch;
+
+	/** Czy kopia nieużywana przez czytelników nie nadąża za drugą, bo
+	 * powtórzenie na niej zmiany się nie udało. */
+	bool stale;
+
+	/** Szereguje pisarzy. */
+	pthread_mutex_t writer;
+};
+
+/** Następny licznik przydzielany wątkowi. */
+static atomic_uint nextStripe;
+
+/** Licznik czytelników przydzielony bieżącemu wątkowi. */
+static _Thread_local unsigned stripe = READER_STRIPES;
+
+/**
+ * @brief Rejestruje czytelnika i zwraca kopię bazy, z której może korzystać.
+ *
+ * @param arg Baza.
+ * @param[out] slot Licznik, który należy zmniejszyć funkcją leave().
+ */
+static struct PhoneForward *
+enter(struct PhoneForwardShared *arg, atomic_size_t **slot)
+{
+	if (stripe == READER_STRIPES)
+		stripe = atomic_fetch_add(&nextStripe, 1) % READER_STRIPES;
+	unsigned epoch = atomic_load(&arg->epoch);
+	*slot = &arg->readers[epoch][stripe].count;
+	atomic_fetch_add(*slot, 1);
+	return arg->base[atomic_load(&arg->front)];
+}
+
+/**
+ * @brief Wyrejestrowuje czytelnika.
+ *
+ * @param slot Licznik zwrócony przez enter().
+ */
+static void
+leave(atomic_size_t *slot)
+{
+	atomic_fetch_sub(slot, 1);
+}
+
+/**
+ * @brief Czeka, aż żaden czytelnik nie będzie w danej epoce.
+ *
+ * @param arg Baza.
+ * @param epoch Epoka.
+ */
+static void
+waitReaders(struct PhoneForwardShared *arg, unsigned epoch)
+{
+	for (unsigned i = 0; i < READER_STRIPES; ++i) {
+		while (atomic_load(&arg->readers[epoch][i].count))
+			sched_yield();
+	}
+}
+
+/**
+ * @brief Udostępnia czytelnikom kopię bazy i czeka, aż żaden czytelnik
+ * nie będzie korzystał z drugiej.
+ *
+ * @param arg Baza.
+ * @param next Indeks udostępnianej kopii.
+ */
+static void
+publish(struct PhoneForwardShared *arg, unsigned next)
+{
+	atomic_store(&arg->front, next);
+	unsigned epoch = atomic_load(&arg->epoch);
+	waitReaders(arg, !epoch);
+	atomic_store(&arg->epoch, !epoch);
+	waitReaders(arg, epoch);
+}
+
+/**
+ * @brief Odtwarza kopię nieużywaną przez czytelników, jeśli nie nadąża ona
+ * za drugą.
+ *
+ * @param arg Baza.
+ *
+ * @return true, jeśli kopia jest aktualna, lub false w przypadku błędu
+ * alokacji.
+ */
+static bool
+refresh(struct PhoneForwardShared *arg)
+{
+	if (!arg->stale) return true;
+	unsigned front = atomic_load(&arg->front);
+	struct PhoneForward *copy = phfwdCopy(arg->base[front]);
+	if (!copy) return false;
+	phfwdDelete(arg->base[!front]);
+	arg->base[!front] = copy;
+	arg->stale = false;
+	return true;
+}
+
+struct PhoneForwardShared *
+phfwdSharedNew(void)
+{
+	struct PhoneForwardShared *new =
+		aligned_alloc(_Alignof(struct PhoneForwardShared),
+		              sizeof(struct PhoneForwardShared));
+	if (!new) return NULL;
+	new->base[0] = phfwdNew();
+	new->base[1] = phfwdNew();
+	if (!new->base[0] || !new->base[1]) {
+		phfwdDelete(new->base[0]);
+		phfwdDelete(new->base[1]);
+		free(new);
+		return NULL;
+	}
+	for (unsigned e = 0; e < 2; ++e) {
+		for (unsigned i = 0; i < READER_STRIPES; ++i)
+			atomic_init(&new->readers[e][i].count, 0);
+	}
+	atomic_init(&new->front, 0);
+	atomic_init(&new->epoch, 0);
+	new->stale = false;
+	pthread_mutex_init(&new->writer, NULL);
+	return new;
+}
+
+void
+phfwdSharedDelete(struct PhoneForwardShared *pf)
+{
+	if (!pf) return;
+	phfwdDelete(pf->base[0]);
+	phfwdDelete(pf->base[1]);
+	pthread_mutex_destroy(&pf->writer);
+	free(pf);
+}
+
+bool
+phfwdSharedAdd(struct PhoneForwardShared *pf, char const *num1,
+               char const *num2)
+{
+	if (!pf) return false;
+	pthread_mutex_lock(&pf->writer);
+	unsigned front = atomic_load(&pf->front);
+	bool ret = refresh(pf) && phfwdAdd(pf->base[!front], num1, num2);
+	if (ret) {
+		publish(pf, !front);
+		if (!phfwdAdd(pf->base[front], num1, num2))
+			pf->stale = true;
+	}
+	pthread_mutex_unlock(&pf->writer);
+	return ret;
+}
+
+bool
+phfwdSharedRemove(struct PhoneForwardShared *pf, char const *num)
+{
+	if (!pf) return false;
+	pthread_mutex_lock(&pf->writer);
+	unsigned front = atomic_load(&pf->front);
+	bool ret = refresh(pf);
+	if (ret) {
+		phfwdRemove(pf->base[!front], num);
+		publish(pf, !front);
+		phfwdRemove(pf->base[front], num);
+	}
+	pthread_mutex_unlock(&pf->writer);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdSharedGet(struct PhoneForwardShared *pf, char const *num)
+{
+	if (!pf) return NULL;
+	atomic_size_t *slot;
+	const struct PhoneNumbers *ret = phfwdGet(enter(pf, &slot), num);
+	leave(slot);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdSharedReverse(struct PhoneForwardShared *pf, char const *num)
+{
+	if (!pf) return NULL;
+	atomic_size_t *slot;
+	const struct PhoneNumbers *ret = phfwdReverse(enter(pf, &slot), num);
+	leave(slot);
+	return ret;
+}
+
+size_t
+phfwdSharedNonTrivialCount(struct PhoneForwardShared *pf, char const *set,
+                           size_t len)
+{
+	if (!pf) return 0;
+	atomic_size_t *slot;
+	size_t ret = phfwdNonTrivialCount(enter(pf, &slot), set, len);
+	leave(slot);
+	return ret;
+}
@@ -0,0 +1,102 @@
+/** @file
+ * Interfejs bazy przekierowań współdzielonej przez wiele wątków.
+ *
+ * Dowolnie wiele wątków może jednocześnie wyszukiwać przekierowania, a jeden
+ * wątek w tym samym czasie je zmieniać. Czytelnicy nigdy nie czekają na
+ * pisarza ani na siebie nawzajem.
+ *
+ * Ceną jest pamięć i czas pisarza. Baza przechowuje dwie pełne kopie
+ * struktury PhoneForward, więc zajmuje dwa razy więcej pamięci niż zwykła
+ * baza. Każda zmiana czeka, aż zakończą się wszystkie wyszukiwania rozpoczęte
+ * przed jej opublikowaniem, także długie wywołania phfwdSharedReverse().
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+#include "phone_forward.h"
+
+/**
+ * Baza przekierowań współdzielona przez wiele wątków.
+ */
+struct PhoneForwardShared;
+
+/** @brief Tworzy nową współdzieloną bazę.
+ * Tworzy bazę niezawierającą żadnych przekierowań.
+ * @return Wskaźnik na utworzoną bazę lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+struct PhoneForwardShared * phfwdSharedNew(void);
+
+/** @brief Usuwa współdzieloną bazę.
+ * Nic nie robi, jeśli wskaźnik @p pf ma wartość NULL. Żaden wątek nie może
+ * w tym czasie korzystać z bazy.
+ * @param[in] pf – wskaźnik na usuwaną bazę.
+ */
+void phfwdSharedDelete(struct PhoneForwardShared *pf);
+
+/** @brief Dodaje przekierowanie.
+ * Działa jak @ref phfwdAdd. Wywołania zmieniające bazę są wykonywane
+ * po kolei, a czytelnicy widzą bazę sprzed zmiany albo po niej. Funkcja
+ * wraca dopiero, gdy żaden czytelnik nie korzysta już z kopii sprzed zmiany.
+ * @param[in] pf   – wskaźnik na bazę;
+ * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
+ *                   przekierowywanych;
+ * @param[in] num2 – wskaźnik na napis reprezentujący prefiks numerów,
+ *                   na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się zaalokować pamięci.
+ */
+bool phfwdSharedAdd(struct PhoneForwardShared *pf, char const *num1,
+                    char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa jak @ref phfwdRemove. Wywołania zmieniające bazę są wykonywane
+ * po kolei, a czytelnicy widzą bazę sprzed zmiany albo po niej.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli zmiana została wykonana, także gdy nie było
+ *         czego usuwać. Wartość @p false, jeśli @p pf ma wartość NULL lub
+ *         nie udało się zaalokować pamięci; wtedy baza pozostaje bez zmian.
+ */
+bool phfwdSharedRemove(struct PhoneForwardShared *pf, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa jak @ref phfwdGet. Może być wywoływana współbieżnie z innymi
+ * funkcjami tego interfejsu.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdSharedGet(struct PhoneForwardShared *pf,
+                                           char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa jak @ref phfwdReverse. Może być wywoływana współbieżnie z innymi
+ * funkcjami tego interfejsu.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdSharedReverse(struct PhoneForwardShared *pf,
+                                               char const *num);
+
+/** @brief Oblicza liczbę nietrywialnych numerów.
+ * Działa jak @ref phfwdNonTrivialCount. Może być wywoływana współbieżnie
+ * z innymi funkcjami tego interfejsu.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] set - napis pełniący funkcję zbioru możliwych cyfr;
+ * @param[in] len - zadana długość nietrywialnych numerów.
+ * @return Liczba nietrywialnych numerów o zadanych własnościach.
+ */
+size_t phfwdSharedNonTrivialCount(struct PhoneForwardShared *pf,
+                                  char const *set, size_t len);
+
+#endif
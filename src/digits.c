@@ -0,0 +1,393 @@
+/** @file
+ * Implementacja operacji na ciągach cyfr upakowanych po dwie w bajcie.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "digits.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+/** Dostępne są wektorowe wersje operacji na x86. */
+#define DIGITS_X86 1
+#else
+/** Dostępne są tylko skalarne wersje operacji. */
+#define DIGITS_X86 0
+#endif
+
+/** Liczba cyfr mieszczących się w słowie 64-bitowym. */
+#define WORD_DIGITS 16
+
+/**
+ * @brief Czyta bajty jako słowo w porządku little-endian.
+ *
+ * @param p Adres pierwszego bajtu.
+ * @param bytes Liczba czytanych bajtów, nie większa niż 8. Pozostałe bajty
+ * słowa są zerowe.
+ */
+static inline uint64_t
+loadLE(const uint8_t *p, size_t bytes)
+{
+	uint64_t ret = 0;
+	if (bytes == sizeof(ret)) {
+		memcpy(&ret, p, sizeof(ret));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		ret = __builtin_bswap64(ret);
+#endif
+		return ret;
+	}
+	for (size_t i = 0; i < bytes; ++i)
+		ret |= (uint64_t)p[i] << (8 * i);
+	return ret;
+}
+
+/**
+ * @brief Czyta fragment upakowanego ciągu do słowa. Cyfra o indeksie
+ * @p off + j trafia na półbajt j słowa, a półbajty za fragmentem są zerowe.
+ *
+ * @param arg Upakowany ciąg.
+ * @param off Indeks pierwszej cyfry.
+ * @param n Długość fragmentu, nie większa niż WORD_DIGITS - @p off % 2, tak
+ * aby fragment mieścił się w ośmiu bajtach.
+ */
+static inline uint64_t
+loadDigits(const uint8_t *arg, size_t off, size_t n)
+{
+	size_t first = off / 2;
+	uint64_t ret = loadLE(arg + first, digitsSize(off + n) - first);
+	ret >>= off % 2 * 4;
+	if (n < WORD_DIGITS)
+		ret &= ((uint64_t)1 << (4 * n)) - 1;
+	return ret;
+}
+
+/**
+ * @brief Ustawia cyfrę upakowanego ciągu.
+ *
+ * @param[out] arg Upakowany ciąg.
+ * @param idx Indeks cyfry.
+ * @param digit Nowa wartość cyfry.
+ */
+static inline void
+setDigit(uint8_t *arg, size_t idx, unsigned digit)
+{
+	unsigned shift = idx % 2 * 4;
+	arg[idx / 2] = (arg[idx / 2] & ~(0xF << shift)) | digit << shift;
+}
+
+#if DIGITS_X86
+
+////////////////////////////////////////////////////////////////////////////////
+// Wersje wektorowe
+//
+// Funkcje czytają całe wyrównane bloki pamięci, również za końcem napisu.
+// Wyrównany blok nie przekracza granicy strony, więc takie czytanie jest
+// bezpieczne, ale AddressSanitizer zgłaszałby je jako błąd.
+
+/** Wyłącza sprawdzanie dostępów przez AddressSanitizer w danej funkcji. */
+#define NO_ASAN __attribute__((no_sanitize_address))
+
+/**
+ * @brief Zwraca maskę bajtów bloku, które nie są cyframi.
+ *
+ * @param v Blok 16 znaków.
+ *
+ * @return Maska bitowa, w której i-ty bit jest zapalony wtedy i tylko wtedy,
+ * gdy i-ty znak bloku nie jest cyfrą.
+ */
+__attribute__((target("sse2"))) static inline unsigned
+nonDigits16(__m128i v)
+{
+	__m128i t = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+	__m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(11)), t);
+	return ~_mm_movemask_epi8(ok) & 0xFFFF;
+}
+
+/**
+ * @brief Wersja digitsSpan() dla SSE2.
+ *
+ * @param num Badany napis.
+ */
+__attribute__((target("sse2"))) NO_ASAN static size_t
+spanSSE2(const char *num)
+{
+	const char *p = (const char*)((uintptr_t)num & ~(uintptr_t)15);
+	unsigned mask = nonDigits16(_mm_load_si128((const __m128i*)p));
+	mask &= 0xFFFFu << (num - p);
+	while (!mask) {
+		p += 16;
+		mask = nonDigits16(_mm_load_si128((const __m128i*)p));
+	}
+	return p + __builtin_ctz(mask) - num;
+}
+
+/**
+ * @brief Wersja digitsSpan() dla AVX2.
+ *
+ * @param num Badany napis.
+ */
+__attribute__((target("avx2"))) NO_ASAN static size_t
+spanAVX2(const char *num)
+{
+	const char *p = (const char*)((uintptr_t)num & ~(uintptr_t)31);
+	const __m256i zero = _mm256_set1_epi8('0');
+	const __m256i max = _mm256_set1_epi8(11);
+	uint32_t mask;
+	for (;;) {
+		__m256i t = _mm256_sub_epi8(_mm256_load_si256((const __m256i*)p), zero);
+		__m256i ok = _mm256_cmpeq_epi8(_mm256_min_epu8(t, max), t);
+		mask = ~(uint32_t)_mm256_movemask_epi8(ok);
+		if (p < num)
+			mask &= 0xFFFFFFFFu << (num - p);
+		if (mask)
+			break;
+		p += 32;
+	}
+	return p + __builtin_ctz(mask) - num;
+}
+
+/**
+ * @brief Wersja digitsPack() dla SSE2. Pakuje 32 cyfry na iterację:
+ * w 16-bitowej połówce zawierającej cyfry x i y jako bajty, wartość
+ * x + 256y po dodaniu jej przesunięcia o 4 bity w prawo ma w młodszym bajcie
+ * x + 16y.
+ *
+ * @param[out] out Bufor na wynik.
+ * @param num Pakowany numer.
+ * @param len Długość numeru.
+ *
+ * @return Liczba spakowanych cyfr, parzysta.
+ */
+__attribute__((target("sse2"))) static size_t
+packSSE2(uint8_t *out, const char *num, size_t len)
+{
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i low = _mm_set1_epi16(0xFF);
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32) {
+		__m128i a = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(num + i)), zero);
+		__m128i b = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(num + i + 16)), zero);
+		a = _mm_and_si128(_mm_add_epi16(a, _mm_srli_epi16(a, 4)), low);
+		b = _mm_and_si128(_mm_add_epi16(b, _mm_srli_epi16(b, 4)), low);
+		_mm_storeu_si128((__m128i*)(out + i / 2), _mm_packus_epi16(a, b));
+	}
+	return i;
+}
+
+/**
+ * @brief Czyta 16 bajtów upakowanego ciągu zaczynając od cyfry @p off.
+ * Dla nieparzystego @p off czyta 17 bajtów i przesuwa je o półbajt.
+ *
+ * @param arg Upakowany ciąg.
+ * @param off Indeks pierwszej cyfry.
+ */
+__attribute__((target("sse2"))) static inline __m128i
+load32Digits(const uint8_t *arg, size_t off)
+{
+	__m128i v = _mm_loadu_si128((const __m128i*)(arg + off / 2));
+	if (off % 2 == 0)
+		return v;
+	__m128i next = _mm_loadu_si128((const __m128i*)(arg + off / 2 + 1));
+	return _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)),
+	                    _mm_and_si128(_mm_slli_epi16(next, 4),
+	                                  _mm_set1_epi8((char)0xF0)));
+}
+
+/**
+ * @brief Wskazuje pierwszą różniącą się cyfrę w bloku.
+ *
+ * @param a Pierwszy ciąg.
+ * @param aOff Indeks początku bloku w @p a.
+ * @param b Drugi ciąg.
+ * @param bOff Indeks początku bloku w @p b.
+ * @param byte Indeks pierwszego różniącego się bajtu bloku.
+ *
+ * @return Indeks pierwszej różniącej się cyfry względem początku bloku.
+ */
+static inline size_t
+firstMismatch(const uint8_t *a, size_t aOff, const uint8_t *b, size_t bOff,
+              unsigned byte)
+{
+	size_t ret = 2 * byte;
+	if (digitAt(a, aOff + ret) == digitAt(b, bOff + ret))
+		++ret;
+	return ret;
+}
+
+/**
+ * @brief Porównuje upakowane ciągi blokami po 32 cyfry przy użyciu SSE2.
+ *
+ * @param a Pierwszy ciąg.
+ * @param aOff Indeks początku fragmentu w @p a.
+ * @param b Drugi ciąg.
+ * @param bOff Indeks początku fragmentu w @p b.
+ * @param len Długość obu fragmentów.
+ * @param[in,out] done Liczba cyfr już porównanych. Po powrocie - liczba cyfr
+ * zgodnych w porównanych blokach.
+ *
+ * @return true, jeśli znaleziono różnicę na pozycji @p done.
+ */
+__attribute__((target("sse2"))) static bool
+prefixSSE2(const uint8_t *a, size_t aOff, const uint8_t *b, size_t bOff,
+           size_t len, size_t *done)
+{
+	size_t i = *done;
+	size_t odd = (aOff | bOff) % 2;
+	for (; i + 32 + odd <= len; i += 32) {
+		__m128i va = load32Digits(a, aOff + i);
+		__m128i vb = load32Digits(b, bOff + i);
+		unsigned neq = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFF;
+		if (neq) {
+			*done = i + firstMismatch(a, aOff + i, b, bOff + i,
+			                          __builtin_ctz(neq));
+			return true;
+		}
+	}
+	*done = i;
+	return false;
+}
+
+/**
+ * @brief Czyta 32 bajty upakowanego ciągu zaczynając od cyfry @p off.
+ * Dla nieparzystego @p off czyta 33 bajty i przesuwa je o półbajt.
+ *
+ * @param arg Upakowany ciąg.
+ * @param off Indeks pierwszej cyfry.
+ */
+__attribute__((target("avx2"))) static inline __m256i
+load64Digits(const uint8_t *arg, size_t off)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i*)(arg + off / 2));
+	if (off % 2 == 0)
+		return v;
+	__m256i next = _mm256_loadu_si256((const __m256i*)(arg + off / 2 + 1));
+	return _mm256_or_si256(
+		_mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)),
+		_mm256_and_si256(_mm256_slli_epi16(next, 4),
+		                 _mm256_set1_epi8((char)0xF0)));
+}
+
+/**
+ * @brief Porównuje upakowane ciągi blokami po 64 cyfry przy użyciu AVX2.
+ * Parametry i wynik jak w prefixSSE2().
+ *
+ * @param a Pierwszy ciąg.
+ * @param aOff Indeks początku fragmentu w @p a.
+ * @param b Drugi ciąg.
+ * @param bOff Indeks początku fragmentu w @p b.
+ * @param len Długość obu fragmentów.
+ * @param[in,out] done Liczba cyfr już porównanych.
+ */
+__attribute__((target("avx2"))) static bool
+prefixAVX2(const uint8_t *a, size_t aOff, const uint8_t *b, size_t bOff,
+           size_t len, size_t *done)
+{
+	size_t i = *done;
+	size_t odd = (aOff | bOff) % 2;
+	for (; i + 64 + odd <= len; i += 64) {
+		__m256i va = load64Digits(a, aOff + i);
+		__m256i vb = load64Digits(b, bOff + i);
+		uint32_t neq = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+		if (neq) {
+			*done = i + firstMismatch(a, aOff + i, b, bOff + i,
+			                          __builtin_ctz(neq));
+			return true;
+		}
+	}
+	*done = i;
+	return false;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Interfejs
+
+size_t
+digitsSpan(const char *num)
+{
+#if DIGITS_X86
+	if (__builtin_cpu_supports("avx2"))
+		return spanAVX2(num);
+	if (__builtin_cpu_supports("sse2"))
+		return spanSSE2(num);
+#endif
+	size_t ret = 0;
+	while (num[ret] >= '0' && num[ret] <= ';')
+		++ret;
+	return ret;
+}
+
+void
+digitsPack(uint8_t *out, const char *num, size_t len)
+{
+	size_t i = 0;
+#if DIGITS_X86
+	if (__builtin_cpu_supports("sse2"))
+		i = packSSE2(out, num, len);
+#endif
+	for (; i + 1 < len; i += 2)
+		out[i / 2] = (num[i] - '0') | (num[i + 1] - '0') << 4;
+	if (i < len)
+		out[i / 2] = num[i] - '0';
+}
+
+void
+digitsUnpack(char *out, const uint8_t *arg, size_t off, size_t len)
+{
+	for (size_t i = 0; i < len; ++i)
+		out[i] = '0' + digitAt(arg, off + i);
+}
+
+void
+digitsCopy(uint8_t *dst, size_t dstOff,
+           const uint8_t *src, size_t srcOff, size_t len)
+{
+	if (dstOff % 2 == 0 && srcOff % 2 == 0) {
+		memcpy(dst + dstOff / 2, src + srcOff / 2, len / 2);
+		if (len % 2)
+			setDigit(dst, dstOff + len - 1, digitAt(src, srcOff + len - 1));
+		return;
+	}
+	for (size_t i = 0; i < len; ++i)
+		setDigit(dst, dstOff + i, digitAt(src, srcOff + i));
+}
+
+size_t
+digitsCommonPrefix(const uint8_t *a, size_t aOff,
+                   const uint8_t *b, size_t bOff, size_t len)
+{
+	size_t done = 0;
+#if DIGITS_X86
+	if (len >= 64 && __builtin_cpu_supports("avx2")
+	    && prefixAVX2(a, aOff, b, bOff, len, &done))
+		return done;
+	if (len - done >= 32 && __builtin_cpu_supports("sse2")
+	    && prefixSSE2(a, aOff, b, bOff, len, &done))
+		return done;
+#endif
+	while (done < len) {
+		size_t n = WORD_DIGITS - ((aOff + done) % 2 | (bOff + done) % 2);
+		if (n > len - done)
+			n = len - done;
+		uint64_t diff = loadDigits(a, aOff + done, n)
+		              ^ loadDigits(b, bOff + done, n);
+		if (diff)
+			return done + __builtin_ctzll(diff) / 4;
+		done += n;
+	}
+	return len;
+}
+
+unsigned
+digitsCharset(const uint8_t *arg, size_t off, size_t len)
+{
+	unsigned acc = 0;
+	for (size_t i = 0; i < len; ++i)
+		acc |= 1u << digitAt(arg, off + i);
+	return acc;
+}
@@ -0,0 +1,121 @@
+/** @file
+ * Interfejs operacji na ciągach cyfr upakowanych po dwie w bajcie.
+ *
+ * Cyframi są znaki od '0' do ';', czyli wartości od 0 do 11, więc każda
+ * mieści się w półbajcie. Cyfra o indeksie i ciągu zajmuje młodszy półbajt
+ * bajtu i / 2, jeśli i jest parzyste, a starszy - jeśli nieparzyste.
+ * Dzięki temu 16 kolejnych cyfr da się porównać jedną operacją na słowie
+ * 64-bitowym.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef DIGITS_H
+#define DIGITS_H
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Zwraca liczbę bajtów potrzebnych na upakowanie @p len cyfr.
+ *
+ * @param len Liczba cyfr.
+ */
+static inline size_t
+digitsSize(size_t len)
+{
+	return (len + 1) / 2;
+}
+
+/**
+ * @brief Zwraca cyfrę upakowanego ciągu.
+ *
+ * @param arg Upakowany ciąg.
+ * @param idx Indeks cyfry.
+ *
+ * @return Wartość cyfry z przedziału [0, 12).
+ */
+static inline unsigned
+digitAt(const uint8_t *arg, size_t idx)
+{
+	return arg[idx / 2] >> (idx % 2 * 4) & 0xF;
+}
+
+/**
+ * @brief Wyznacza długość najdłuższego prefiksu napisu składającego się
+ * z cyfr.
+ * Na procesorach x86 z SSE2 lub AVX2 sprawdza 16 lub 32 znaki naraz.
+ *
+ * @param num Badany napis zakończony znakiem '\0'.
+ *
+ * @return Indeks pierwszego znaku @p num niebędącego cyfrą.
+ */
+size_t digitsSpan(const char *num);
+
+/**
+ * @brief Pakuje numer zapisany jako napis.
+ *
+ * @param[out] out Bufor na co najmniej digitsSize(@p len) bajtów.
+ * @param num Numer składający się wyłącznie z cyfr.
+ * @param len Długość numeru.
+ */
+void digitsPack(uint8_t *out, const char *num, size_t len);
+
+/**
+ * @brief Rozpakowuje fragment upakowanego ciągu do napisu.
+ * Nie dopisuje '\0' na końcu.
+ *
+ * @param[out] out Bufor na co najmniej @p len znaków.
+ * @param arg Upakowany ciąg.
+ * @param off Indeks pierwszej rozpakowywanej cyfry.
+ * @param len Liczba rozpakowywanych cyfr.
+ */
+void digitsUnpack(char *out, const uint8_t *arg, size_t off, size_t len);
+
+/**
+ * @brief Kopiuje fragment upakowanego ciągu do innego upakowanego ciągu.
+ * Fragmenty nie mogą na siebie zachodzić. Półbajty @p dst spoza docelowego
+ * fragmentu nie są zmieniane.
+ *
+ * @param[out] dst Ciąg docelowy.
+ * @param dstOff Indeks pierwszej cyfry docelowego fragmentu.
+ * @param src Ciąg źródłowy.
+ * @param srcOff Indeks pierwszej cyfry kopiowanego fragmentu.
+ * @param len Liczba kopiowanych cyfr.
+ */
+void digitsCopy(uint8_t *dst, size_t dstOff,
+                const uint8_t *src, size_t srcOff, size_t len);
+
+/**
+ * @brief Wyznacza długość najdłuższego wspólnego prefiksu dwóch fragmentów
+ * upakowanych ciągów.
+ * Porównuje słowami 64-bitowymi: różnica XOR dwóch słów wskazuje pierwszą
+ * różniącą się cyfrę przez liczbę zerowych bitów na jej młodszym końcu.
+ * Długie fragmenty porównuje blokami po 32 lub 64 cyfry przy użyciu SSE2
+ * lub AVX2, jeśli procesor je obsługuje.
+ * Czyta wyłącznie bajty zawierające cyfry porównywanych fragmentów.
+ *
+ * @param a Pierwszy ciąg.
+ * @param aOff Indeks początku fragmentu w @p a.
+ * @param b Drugi ciąg.
+ * @param bOff Indeks początku fragmentu w @p b.
+ * @param len Długość obu fragmentów.
+ *
+ * @return Długość wspólnego prefiksu, nie większa niż @p len.
+ */
+size_t digitsCommonPrefix(const uint8_t *a, size_t aOff,
+                          const uint8_t *b, size_t bOff, size_t len);
+
+/**
+ * @brief Zwraca zbiór cyfr fragmentu upakowanego ciągu zakodowany bitowo.
+ * n-ty najmniej znaczący bit w wyniku jest zapalony wtedy i tylko wtedy,
+ * gdy cyfra n występuje we fragmencie.
+ *
+ * @param arg Upakowany ciąg.
+ * @param off Indeks początku fragmentu.
+ * @param len Długość fragmentu.
+ */
+unsigned digitsCharset(const uint8_t *arg, size_t off, size_t len);
+
+#endif
@@ -0,0 +1,378 @@
+/** @file
+ * Implementacja historii zmian przekierowań.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+
+/** Początkowy rozmiar tablicy wpisów. */
+#define HISTORY_MIN_CAP 64
+
+/**
+ * @brief Wyznacza skrót słowa (FNV-1a).
+ *
+ * @param word Napis, którego prefiks jest słowem.
+ * @param len Długość słowa.
+ */
+static size_t
+hashWord(const char *word, size_t len)
+{
+	size_t ret = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; ++i) {
+		ret ^= (unsigned char)word[i];
+		ret *= 1099511628211ULL;
+	}
+	return ret;
+}
+
+/**
+ * @brief Kopiuje napis do pamięci zaalokowanej przez malloc().
+ *
+ * @param arg Napis lub NULL.
+ * @param[out] out Kopia lub NULL, jeśli @p arg ma wartość NULL.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+copyString(const char *arg, char **out)
+{
+	*out = NULL;
+	if (!arg) return true;
+	size_t len = strlen(arg);
+	*out = malloc(len + 1);
+	if (!*out) return false;
+	memcpy(*out, arg, len + 1);
+	return true;
+}
+
+/**
+ * @brief Wyszukuje miejsce słowa w tablicy wpisów.
+ *
+ * @param arg Historia z niepustą tablicą.
+ * @param word Napis, którego prefiks jest słowem.
+ * @param len Długość słowa.
+ * @param hash Skrót słowa.
+ *
+ * @return Wpis słowa lub puste miejsce, w którym należy go umieścić.
+ */
+static struct HistoryEntry *
+findSlot(const struct History *arg, const char *word, size_t len, size_t hash)
+{
+	size_t mask = arg->cap - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		struct HistoryEntry *e = &arg->slots[i];
+		if (!e->word || (e->hash == hash && e->len == len
+		                 && !memcmp(e->word, word, len)))
+			return e;
+	}
+}
+
+/**
+ * @brief Wyszukuje miejsce celu w tablicy indeksu celów.
+ *
+ * @param arg Historia z niepustą tablicą celów.
+ * @param target Napis, którego prefiks jest celem.
+ * @param len Długość celu.
+ * @param hash Skrót celu.
+ *
+ * @return Wpis celu lub puste miejsce, w którym należy go umieścić.
+ */
+static struct TargetEntry *
+findTarget(const struct History *arg, const char *target, size_t len,
+           size_t hash)
+{
+	size_t mask = arg->targetCap - 1;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		struct TargetEntry *e = &arg->targets[i];
+		if (!e->target || (e->hash == hash && e->len == len
+		                   && !memcmp(e->target, target, len)))
+			return e;
+	}
+}
+
+/**
+ * @brief Wyznacza rozmiar tablicy dla danej liczby wpisów.
+ *
+ * @param size Liczba wpisów.
+ *
+ * @return Najmniejsza potęga dwójki, nie mniejsza niż HISTORY_MIN_CAP, przy
+ * której tablica jest zajęta co najwyżej w połowie.
+ */
+static size_t
+capFor(size_t size)
+{
+	size_t cap = HISTORY_MIN_CAP;
+	while (2 * size > cap)
+		cap *= 2;
+	return cap;
+}
+
+/**
+ * @brief Przenosi wpisy słów do nowej tablicy, zwalniając wpisy bez zmian.
+ *
+ * @param arg Historia.
+ * @param size Liczba wpisów, które musi pomieścić nowa tablica.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+resize(struct History *arg, size_t size)
+{
+	size_t cap = capFor(size);
+	struct HistoryEntry *slots = calloc(cap, sizeof(struct HistoryEntry));
+	if (!slots) return false;
+	struct History new = *arg;
+	new.slots = slots;
+	new.cap = cap;
+	new.size = 0;
+	for (size_t i = 0; i < arg->cap; ++i) {
+		struct HistoryEntry *e = &arg->slots[i];
+		if (!e->word) continue;
+		if (e->count) {
+			*findSlot(&new, e->word, e->len, e->hash) = *e;
+			++new.size;
+		} else {
+			free(e->changes);
+			free(e->word);
+		}
+	}
+	free(arg->slots);
+	*arg = new;
+	return true;
+}
+
+/**
+ * @brief Przenosi wpisy celów do nowej tablicy, zwalniając wpisy bez słów.
+ *
+ * @param arg Historia.
+ * @param size Liczba wpisów, które musi pomieścić nowa tablica.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+resizeTargets(struct History *arg, size_t size)
+{
+	size_t cap = capFor(size);
+	struct TargetEntry *targets = calloc(cap, sizeof(struct TargetEntry));
+	if (!targets) return false;
+	struct History new = *arg;
+	new.targets = targets;
+	new.targetCap = cap;
+	new.targetSize = 0;
+	for (size_t i = 0; i < arg->targetCap; ++i) {
+		struct TargetEntry *e = &arg->targets[i];
+		if (!e->target) continue;
+		if (e->count) {
+			*findTarget(&new, e->target, e->len, e->hash) = *e;
+			++new.targetSize;
+		} else {
+			free(e->words);
+			free(e->target);
+		}
+	}
+	free(arg->targets);
+	*arg = new;
+	return true;
+}
+
+/**
+ * @brief Dopisuje do indeksu celów słowo przekierowane przed zmianą na dany
+ * cel.
+ *
+ * @param arg Historia.
+ * @param target Cel.
+ * @param word Słowo, wskazuje na pole word wpisu słowa.
+ * @param version Wersja bazy po zmianie.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+recordTarget(struct History *arg, const char *target, const char *word,
+             size_t version)
+{
+	if (2 * (arg->targetSize + 1) > arg->targetCap
+	    && !resizeTargets(arg, arg->targetSize + 1))
+		return false;
+	size_t len = strlen(target);
+	size_t hash = hashWord(target, len);
+	struct TargetEntry *e = findTarget(arg, target, len, hash);
+	if (!e->target) {
+		char *copy;
+		if (!copyString(target, &copy)) return false;
+		*e = (struct TargetEntry){copy, len, hash, NULL, 0, 0};
+		++arg->targetSize;
+	}
+	if (e->count == e->cap) {
+		size_t cap = e->cap ? 2 * e->cap : 1;
+		struct TargetWord *words = realloc(e->words,
+		                                   cap * sizeof(struct TargetWord));
+		if (!words) return false;
+		e->words = words;
+		e->cap = cap;
+	}
+	e->words[e->count++] = (struct TargetWord){word, version};
+	return true;
+}
+
+/**
+ * @brief Wyznacza przekierowanie słowa w danej wersji na podstawie jego
+ * zmian.
+ *
+ * @param arg Wpis słowa.
+ * @param version Wersja.
+ * @param[out] old Przekierowanie w wersji @p version.
+ *
+ * @return true, jeśli przekierowanie zmieniło się po wersji @p version.
+ */
+static bool
+entryFind(const struct HistoryEntry *arg, size_t version, const char **old)
+{
+	size_t lo = 0, hi = arg->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (arg->changes[mid].version <= version)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == arg->count) return false;
+	*old = arg->changes[lo].old;
+	return true;
+}
+
+void
+historyInit(struct History *arg)
+{
+	*arg = (struct History){NULL, 0, 0, NULL, 0, 0};
+}
+
+void
+historyClear(struct History *arg)
+{
+	for (size_t i = 0; i < arg->cap; ++i) {
+		struct HistoryEntry *e = &arg->slots[i];
+		if (!e->word) continue;
+		for (size_t j = 0; j < e->count; ++j)
+			free(e->changes[j].old);
+		free(e->changes);
+		free(e->word);
+	}
+	for (size_t i = 0; i < arg->targetCap; ++i) {
+		free(arg->targets[i].words);
+		free(arg->targets[i].target);
+	}
+	free(arg->slots);
+	free(arg->targets);
+	historyInit(arg);
+}
+
+bool
+historyRecord(struct History *arg, const char *word, const char *old,
+              size_t version)
+{
+	if (2 * (arg->size + 1) > arg->cap && !resize(arg, arg->size + 1))
+		return false;
+	size_t len = strlen(word);
+	size_t hash = hashWord(word, len);
+	struct HistoryEntry *e = findSlot(arg, word, len, hash);
+	if (!e->word) {
+		char *copy;
+		if (!copyString(word, &copy)) return false;
+		*e = (struct HistoryEntry){copy, len, hash, NULL, 0, 0};
+		++arg->size;
+	}
+	if (e->count == e->cap) {
+		size_t cap = e->cap ? 2 * e->cap : 1;
+		struct Change *changes = realloc(e->changes,
+		                                 cap * sizeof(struct Change));
+		if (!changes) return false;
+		e->changes = changes;
+		e->cap = cap;
+	}
+	char *copy;
+	if (!copyString(old, &copy)) return false;
+	if (old && !recordTarget(arg, old, e->word, version)) {
+		free(copy);
+		return false;
+	}
+	e->changes[e->count++] = (struct Change){version, copy};
+	return true;
+}
+
+void
+historyTrim(struct History *arg, size_t version)
+{
+	/* Zmiany słowa i słowa celu są uporządkowane według wersji, więc
+	 * usuwane są prefiksy ich tablic. */
+	size_t size = 0;
+	for (size_t i = 0; i < arg->cap; ++i) {
+		struct HistoryEntry *e = &arg->slots[i];
+		if (!e->word) continue;
+		size_t drop = 0;
+		while (drop < e->count && e->changes[drop].version <= version)
+			free(e->changes[drop++].old);
+		e->count -= drop;
+		memmove(e->changes, e->changes + drop,
+		        e->count * sizeof(struct Change));
+		size += e->count > 0;
+	}
+	size_t targetSize = 0;
+	for (size_t i = 0; i < arg->targetCap; ++i) {
+		struct TargetEntry *e = &arg->targets[i];
+		if (!e->target) continue;
+		size_t drop = 0;
+		while (drop < e->count && e->words[drop].version <= version)
+			++drop;
+		e->count -= drop;
+		memmove(e->words, e->words + drop,
+		        e->count * sizeof(struct TargetWord));
+		targetSize += e->count > 0;
+	}
+	/* Słowa celów wskazują na słowa wpisów, ale te zwalniane przez
+	 * resize() nie mają już zmian, więc nie występują w indeksie celów. */
+	resizeTargets(arg, targetSize);
+	resize(arg, size);
+}
+
+void
+historyRollback(struct History *arg, size_t version)
+{
+	for (size_t i = 0; i < arg->cap; ++i) {
+		struct HistoryEntry *e = &arg->slots[i];
+		while (e->count > 0 && e->changes[e->count - 1].version == version)
+			free(e->changes[--e->count].old);
+	}
+	for (size_t i = 0; i < arg->targetCap; ++i) {
+		struct TargetEntry *e = &arg->targets[i];
+		while (e->count > 0 && e->words[e->count - 1].version == version)
+			--e->count;
+	}
+}
+
+bool
+historyFind(const struct History *arg, const char *word, size_t len,
+            size_t version, const char **old)
+{
+	if (arg->size == 0) return false;
+	const struct HistoryEntry *e = findSlot(arg, word, len,
+	                                        hashWord(word, len));
+	return e->word && entryFind(e, version, old);
+}
+
+const struct TargetWord *
+historyTargets(const struct History *arg, const char *target, size_t len,
+               size_t *count)
+{
+	*count = 0;
+	if (arg->targetSize == 0) return NULL;
+	const struct TargetEntry *e = findTarget(arg, target, len,
+	                                         hashWord(target, len));
+	if (!e->target) return NULL;
+	*count = e->count;
+	return e->words;
+}
@@ -0,0 +1,152 @@
+/** @file
+ * Interfejs historii zmian przekierowań, z której korzystają migawki bazy.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Zmiana przekierowania słowa.
+ */
+struct Change {
+	size_t version; ///< Wersja bazy, która powstała w wyniku zmiany.
+	char *old; ///< Przekierowanie sprzed zmiany lub NULL, jeśli go nie było.
+};
+
+/**
+ * Ciąg zmian przekierowania jednego słowa, od najstarszej.
+ */
+struct HistoryEntry {
+	char *word; ///< Słowo lub NULL dla pustego miejsca tablicy.
+	size_t len; ///< Długość słowa.
+	size_t hash; ///< Skrót słowa.
+	struct Change *changes; ///< Zmiany.
+	size_t count; ///< Liczba zmian.
+	size_t cap; ///< Pojemność tablicy @p changes.
+};
+
+/**
+ * Słowo, które przed zmianą było przekierowane na dany cel.
+ */
+struct TargetWord {
+	const char *word; ///< Słowo, wskazuje na pole word wpisu słowa.
+	size_t version; ///< Wersja bazy, która powstała w wyniku zmiany.
+};
+
+/**
+ * Słowa, które przed swoimi zmianami były przekierowane na jeden cel,
+ * w kolejności zmian.
+ */
+struct TargetEntry {
+	char *target; ///< Cel lub NULL dla pustego miejsca tablicy.
+	size_t len; ///< Długość celu.
+	size_t hash; ///< Skrót celu.
+	struct TargetWord *words; ///< Słowa.
+	size_t count; ///< Liczba słów.
+	size_t cap; ///< Pojemność tablicy @p words.
+};
+
+/**
+ * @brief Historia zmian przekierowań.
+ *
+ * Tablica z haszowaniem otwartym, której kluczami są słowa, oraz indeks
+ * zmian według poprzednich przekierowań, tablica z haszowaniem otwartym,
+ * której kluczami są cele. Wpisy nie są usuwane pojedynczo, tylko razem
+ * ze wszystkimi zmianami starszymi od danej wersji przez historyTrim().
+ */
+struct History {
+	struct HistoryEntry *slots; ///< Tablica wpisów.
+	size_t cap; ///< Rozmiar tablicy, potęga dwójki lub zero.
+	size_t size; ///< Liczba zajętych wpisów.
+	struct TargetEntry *targets; ///< Tablica wpisów indeksu celów.
+	size_t targetCap; ///< Rozmiar tablicy celów, potęga dwójki lub zero.
+	size_t targetSize; ///< Liczba zajętych wpisów indeksu celów.
+};
+
+/**
+ * @brief Inicjalizuje pustą historię.
+ *
+ * @param arg Historia.
+ */
+void historyInit(struct History *arg);
+
+/**
+ * @brief Usuwa wszystkie zmiany z historii i zwalnia jej pamięć.
+ * Po wywołaniu historia jest pusta i może być dalej używana.
+ *
+ * @param arg Historia.
+ */
+void historyClear(struct History *arg);
+
+/**
+ * @brief Zapisuje zmianę przekierowania słowa.
+ * Wersje kolejnych zmian tego samego słowa nie mogą maleć.
+ *
+ * @param arg Historia.
+ * @param word Słowo.
+ * @param old Przekierowanie słowa sprzed zmiany lub NULL.
+ * @param version Wersja bazy po zmianie.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+bool historyRecord(struct History *arg, const char *word, const char *old,
+                   size_t version);
+
+/**
+ * @brief Usuwa z historii zmiany o wersjach nie większych niż podana.
+ * Nie są one potrzebne, jeśli nie istnieje migawka starsza od @p version.
+ * Słowa i cele bez zmian są usuwane z tablic, o ile uda się zaalokować
+ * pamięć na mniejsze tablice.
+ *
+ * @param arg Historia.
+ * @param version Wersja.
+ */
+void historyTrim(struct History *arg, size_t version);
+
+/**
+ * @brief Wycofuje wszystkie zmiany o podanej wersji.
+ * Zakłada, że jest to najnowsza wersja w historii.
+ *
+ * @param arg Historia.
+ * @param version Wersja.
+ */
+void historyRollback(struct History *arg, size_t version);
+
+/**
+ * @brief Sprawdza, czy przekierowanie słowa zmieniło się po danej wersji.
+ *
+ * @param arg Historia.
+ * @param word Napis, którego prefiks jest słowem.
+ * @param len Długość słowa.
+ * @param version Wersja.
+ * @param[out] old Przekierowanie słowa w wersji @p version lub NULL, jeśli
+ * go nie było. Ustawiane tylko, jeśli wynikiem jest true.
+ *
+ * @return true, jeśli przekierowanie zmieniło się po wersji @p version.
+ */
+bool historyFind(const struct History *arg, const char *word, size_t len,
+                 size_t version, const char **old);
+
+/**
+ * @brief Zwraca słowa, które przed zmianą były przekierowane na dany cel.
+ * Każde słowo występuje raz dla każdej takiej zmiany, więc przekierowanie
+ * słowa w danej wersji trzeba sprawdzić funkcją historyFind().
+ *
+ * @param arg Historia.
+ * @param target Napis, którego prefiks jest celem.
+ * @param len Długość celu.
+ * @param[out] count Liczba słów.
+ *
+ * @return Tablica słów w kolejności zmian.
+ */
+const struct TargetWord * historyTargets(const struct History *arg,
+                                         const char *target, size_t len,
+                                         size_t *count);
+
+#endif
@@ -6,18 +6,87 @@
  * @date 18.05.2018
  */
 
+/** Udostępnia blokady pthread_rwlock_t przy kompilacji w trybie C11. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "arena.h"
+#include "bitvector.h"
+#include "digits.h"
+#include "history.h"
 #include "phone_forward.h"
+#include "pool.h"
 
 /**
- * Struktura przechowująca ciąg numerów telefonów.
+ * Struktura przechowująca ciąg numerów telefonów. Numery leżą w tym samym
+ * bloku pamięci co struktura, za tablicą wskaźników.
  */
 struct PhoneNumbers {
 	size_t size; ///< Rozmiar tablicy numerów.
 	const char *data[]; ///< Tablica numerów.
 };
 
+/** Maksymalna długość etykiety przechowywanej bezpośrednio w wierzchołku. */
+#define LABEL_INLINE 32
+
+/** Długość numeru, którego upakowane cyfry mieszczą się w buforze na stosie. */
+#define KEY_INLINE 64
+
+/** Liczba cyfr, czyli znaków od '0' do ';'. */
+#define DIGITS 12
+
+/** Liczba przeplatanych wyszukiwań w phfwdGetMany(). */
+#define LOOKUP_GROUP 16
+
+/** Minimalna liczba słów, na które istnieją przekierowania, od której
+ * phfwdNonTrivialCountPattern() dzieli przeszukiwanie między wątki. */
+#define PARALLEL_MIN_TARGETS 4096
+
+/** Minimalna liczba par (zbiór cyfr, licznik), od której
+ * phfwdNonTrivialCountBatch() dzieli obliczenia między wątki. */
+#define PARALLEL_MIN_TERMS 65536
+
+/** Minimalna liczba przekierowań, od której phfwdAddBulk() dzieli budowę
+ * drzew między wątki. */
+#define PARALLEL_MIN_RULES 65536
+
+/** Liczba zadań na wątek, na które są dzielone obliczenia równoległe. */
+#define TASKS_PER_THREAD 8
+
+/** Liczba słów, poniżej której phfwdAddBulk() sortuje przez wstawianie. */
+#define BULK_INSERTION_SORT 32
+
+/** Liczba początkowych cyfr słowa w kluczu sortowania phfwdAddBulk(). */
+#define BULK_KEY_DIGITS 16
+
+/** Znacznik początku pliku zapisanego przez phfwdSave(). */
+#define SAVE_MAGIC "PHFW"
+
+/** Wersja formatu pliku zapisywanego przez phfwdSave(). */
+#define SAVE_VERSION 1
+
+/** Wartość, po której phfwdLoad() rozpoznaje kolejność bajtów w pliku. */
+#define SAVE_BYTE_ORDER 0x01020304u
+
+/** Początkowy rozmiar bufora, do którego phfwdLoad() wczytuje plik. */
+#define LOAD_MIN_BUFFER 65536
+
+/** Znacznik początku pliku zapisanego przez phfwdFreeze(). */
+#define FROZEN_MAGIC "PHFZ"
+
+/** Wersja formatu pliku zapisywanego przez phfwdFreeze(). */
+#define FROZEN_VERSION 1
+
+/** Wyrównanie sekcji pliku zapisywanego przez phfwdFreeze(). */
+#define FROZEN_ALIGN 8
+
 /**
  * @brief Wydajna mapa, której dziedziną są słowa.
  *
@@ -25,53 +94,106 @@ struct PhoneNumbers {
  * Każdy wierzchołek posiada etykietę (label). Słowo, które odpowiada
  * wierzchołkowi, jest konkatenacją wszystkich etykiet na ścieżce od korzenia
  * do tego wierzchołka włącznie. Etykiety rodzeństwa nie mają wspólnych
- * prefiksów. Rodzeństwo jest posortowane leksykograficznie względem etykiet.
+ * prefiksów, więc dziecko jest jednoznacznie wyznaczone przez pierwszą cyfrę
+ * swojej etykiety.
  *
- * Każdy wierzchołek może należeć do "cyklu przekierowań". W jednym cyklu
- * przekierowań znajduje się jedno słowo z drzewa "to" (patrz PhoneForward)
- * oraz wszystkie słowa z drzewa "from", które są na nie przekierowane.
+ * Wierzchołek z drzewa "from" (patrz PhoneForward) może być przekierowany
+ * na wierzchołek z drzewa "to". Wierzchołek z drzewa "to" przechowuje
+ * posortowany wektor wszystkich słów, które są na niego przekierowane.
  */
 struct RadixTree {
-	/** Wskazuje na lewego brata wierzchołka, jeśli istnieje,
-	 * lub na rodzica, a w przypadku korzenia - na siebie. */
-	struct RadixTree *leftSibling;
-
-	/** Wskazuje na prawego brata wierzchołka, jeśli istnieje,
-	 * lub na rodzica, a w przypadku korzenia - na siebie. */
-	struct RadixTree *rightSibling;
-
-	/** Wskazuje na skrajnie prawe (a więc pierwsze od lewej) dziecko,
-	 * jeśli istnieje, lub na siebie. */
-	struct RadixTree *leftChild;
+	/** Zbiór pierwszych cyfr etykiet dzieci: bit d jest zapalony wtedy
+	 * i tylko wtedy, gdy istnieje dziecko, którego etykieta zaczyna się cyfrą
+	 * d. Pozycja dziecka w tablicy children to liczba zapalonych bitów
+	 * mniej znaczących niż d. */
+	uint16_t childMask;
 
-	/** Wskazuje na skrajnie lewe (a więc pierwsze od prawej) dziecko,
-	 * jeśli istnieje, lub na siebie. */
-	struct RadixTree *rightChild;
+	/** Pojemność tablicy children. */
+	uint16_t childCap;
 
-	/** Wskazuje na lewego sąsiada w cyklu przekierowań, jeśli istnieje,
-	 * lub na siebie. */
-	struct RadixTree *leftRev;
-
-	/** Wskazuje na prawego sąsiada w cyklu przekierowań, jeśli istnieje,
-	 * lub na siebie. */
-	struct RadixTree *rightRev;
+	/** Długość etykiety. */
+	unsigned labelLength;
 
-	/** Etykieta wierzchołka. */
-	char *label;
+	/** Etykieta wierzchołka w postaci upakowanych cyfr (patrz digits.h).
+	 * Etykiety o długości co najwyżej LABEL_INLINE są przechowywane w samym
+	 * wierzchołku, dłuższe - w arenie. */
+	union {
+		uint8_t inl[LABEL_INLINE / 2]; ///< Krótka etykieta.
+		uint8_t *ptr; ///< Długa etykieta.
+	} label;
 
-	/** Pełne słowo odpowiadające wierzchołkowi, jeśli znajduje się on
-	 * w cyklu przekierowań, lub NULL. */
-	char *fullWord;
+	/** Dzieci wierzchołka posortowane według pierwszych cyfr etykiet
+	 * lub NULL, jeśli wierzchołek nie ma dzieci. */
+	struct RadixTree **children;
 
 	/** Odpowiedni wierzchołek z drzewa "to", na który dany wierzchołek
 	 * z "from" jest przekierowany, lub NULL.*/
 	struct RadixTree *fwd;
 
+	/** Rodzic wierzchołka lub NULL dla korzenia. */
+	struct RadixTree *parent;
+
+	/** Słowa z drzewa "from" przekierowane na dany wierzchołek z "to" lub
+	 * NULL, jeśli takich nie ma. */
+	struct Sources *sources;
+
+	/** Pełne słowo odpowiadające wierzchołkowi, jeśli jest on przekierowany
+	 * lub są na niego przekierowane jakieś słowa, lub NULL. */
+	char *fullWord;
+
 	/** Zakodowany przez charset() zbiór cyfr w etykiecie. */
 	unsigned charset;
+};
 
-	/** Długość etykiety. */
-	unsigned labelLength;
+/**
+ * Słowo z drzewa "from" przekierowane na pewne słowo z drzewa "to".
+ */
+struct Source {
+	const char *word; ///< Pełne słowo.
+	struct RadixTree *node; ///< Wierzchołek odpowiadający słowu.
+};
+
+/**
+ * Wektor słów przekierowanych na dane słowo, posortowany leksykograficznie.
+ */
+struct Sources {
+	size_t count; ///< Liczba słów.
+	size_t cap; ///< Pojemność tablicy @p item.
+	size_t bytes; ///< Łączna długość słów.
+	struct Source item[]; ///< Słowa.
+};
+
+/**
+ * Liczba minimalnych nietrywialnych słów o ustalonej długości i zbiorze cyfr.
+ */
+struct CountTerm {
+	unsigned mask; ///< Zakodowany przez charset() zbiór cyfr słów.
+	size_t count; ///< Liczba słów.
+};
+
+/**
+ * Liczniki minimalnych nietrywialnych słów o ustalonej długości,
+ * posortowane według zbiorów cyfr.
+ */
+struct CountLevel {
+	struct CountTerm *terms; ///< Liczniki.
+	size_t size; ///< Liczba liczników.
+	size_t cap; ///< Pojemność tablicy @p terms.
+};
+
+/**
+ * Podsumowanie drzewa "to" na potrzeby phfwdNonTrivialCount().
+ *
+ * Numer jest nietrywialny wtedy i tylko wtedy, gdy jego prefiksem jest słowo,
+ * na które istnieje przekierowanie. Wystarczy więc znać słowa minimalne,
+ * czyli takie, których żaden właściwy prefiks nie jest przekierowany.
+ * Każde z nich, o długości d i zbiorze cyfr m, wnosi do wyniku dla zbioru S
+ * i długości n składnik |S|^(n - d), o ile m ⊆ S i d <= n, więc wystarczy
+ * pamiętać liczbę słów minimalnych dla każdej pary (d, m).
+ */
+struct CountIndex {
+	struct CountLevel *levels; ///< Liczniki dla kolejnych długości słów.
+	size_t depth; ///< Liczba elementów tablicy @p levels.
 };
 
 /**
@@ -83,6 +205,103 @@ struct PhoneForward {
 
 	/** Drzewo słów, na które istnieją przekierowania. */
 	struct RadixTree *to;
+
+	/** Alokator wierzchołków obu drzew, ich etykiet i pełnych słów. */
+	struct Arena mem;
+
+	/** Liczniki minimalnych słów, na które istnieją przekierowania. */
+	struct CountIndex counts;
+
+	/** Liczba słów, na które istnieją przekierowania. */
+	size_t targets;
+
+	/** Pula wątków dla zapytań o liczbę numerów nietrywialnych lub NULL. */
+	struct Pool *pool;
+
+	/** Liczba wykonanych zmian przekierowań. */
+	size_t version;
+
+	/** Liczba istniejących migawek struktury. */
+	size_t snapshots;
+
+	/** Istniejące migawki w kolejności utworzenia, czyli niemalejących
+	 * wersji. */
+	struct PhoneForwardSnapshot **snapshotList;
+
+	/** Pojemność tablicy @p snapshotList. */
+	size_t snapshotCap;
+
+	/** Zmiany przekierowań wykonane od utworzenia najstarszej istniejącej
+	 * migawki. */
+	struct History history;
+
+	/** Blokada drzew i historii. Zapytania do migawek biorą ją do odczytu,
+	 * a zmiany przekierowań i usuwanie migawek do zapisu. */
+	pthread_rwlock_t lock;
+};
+
+/**
+ * Migawka struktury przechowującej przekierowania. Stan z chwili utworzenia
+ * migawki jest odtwarzany z bieżących drzew i historii późniejszych zmian.
+ */
+struct PhoneForwardSnapshot {
+	/** Struktura, której dotyczy migawka, lub NULL, jeśli została już
+	 * usunięta. */
+	struct PhoneForward *pf;
+	size_t version; ///< Wersja struktury w chwili utworzenia migawki.
+};
+
+/**
+ * Wynik wyszukiwania odwrotnego w migawce jako para napisów.
+ */
+struct RevPair {
+	const char *word; ///< Słowo przekierowane na prefiks numeru.
+	const char *suffix; ///< Sufiks numeru za tym prefiksem.
+};
+
+/**
+ * Numer podany przez użytkownika wraz z jego upakowanymi cyframi.
+ */
+struct Key {
+	const char *text; ///< Numer w postaci napisu.
+	size_t len; ///< Długość numeru.
+	uint8_t *digits; ///< Upakowane cyfry numeru.
+	uint8_t buf[KEY_INLINE / 2]; ///< Bufor na cyfry krótkich numerów.
+};
+
+/**
+ * Zapytanie wsadowe o przekierowanie numeru wraz z jego wynikiem.
+ */
+struct BatchQuery {
+	const char *num; ///< Numer, dla którego isNumber() zwraca true.
+	size_t len; ///< Długość numeru.
+	size_t idx; ///< Indeks zapytania w danych wejściowych.
+	const char *prefix; ///< Numer, na który przekierowano prefiks @p num.
+	size_t suffix; ///< Początek nieprzekierowanego sufiksu @p num.
+};
+
+/**
+ * Wierzchołek na ścieżce przeszukiwania drzewa w zapytaniu wsadowym.
+ */
+struct PathStep {
+	struct RadixTree *node; ///< Wierzchołek.
+	size_t pos; ///< Długość słowa odpowiadającego wierzchołkowi.
+	const char *prefix; ///< Najlepsze przekierowanie do tego miejsca.
+	size_t suffix; ///< Początek sufiksu dla tego przekierowania.
+};
+
+/**
+ * Stan wyszukiwania przekierowania, które jest przeplatane z innymi
+ * wyszukiwaniami (patrz lookupStep()).
+ */
+struct Lookup {
+	struct Key key; ///< Szukany numer.
+	struct BatchQuery *query; ///< Zapytanie, do którego trafi wynik.
+	struct RadixTree *node; ///< Wierzchołek do odwiedzenia lub NULL.
+	struct RadixTree **slot; ///< Miejsce w tablicy dzieci do odczytania.
+	size_t pos; ///< Długość dopasowanego prefiksu numeru.
+	struct RadixTree *best; ///< Cel najdłuższego znalezionego przekierowania.
+	size_t suffix; ///< Początek sufiksu dla tego przekierowania.
 };
 
 /** Typedef dla zwięzłości. */
@@ -93,18 +312,19 @@ typedef struct RadixTree rt;
 // Pomocnicze operacje na stringach
 
 /**
- * @brief Alokuje kopię stringu.
+ * @brief Alokuje w arenie kopię stringu.
  *
+ * @param mem Alokator.
  * @param begin Początek stringu.
  * @param end Wskaźnik za ostatni znak do skopiowania. Jeśli wynosi NULL, to
  * kopiowane jest cały string aż do '\0'.
  * @return Wskaźnik na kopię lub NULL w przypadku błędu alokacji.
  */
 static char *
-copyString (const char *begin, const char *end)
+arenaCopy (struct Arena *mem, const char *begin, const char *end)
 {
 	size_t len = end ? (size_t)(end - begin) : strlen(begin);
-	char *new = malloc(len + 1);
+	char *new = arenaAlloc(mem, len + 1);
 	if (!new) return NULL;
 	memcpy (new, begin, len);
 	new[len] = '\0';
@@ -112,21 +332,17 @@ copyString (const char *begin, const char *end)
 }
 
 /**
- * @brief Alokuje konkatenację dwóch stringów.
+ * @brief Zwraca do areny string zaalokowany przez arenaCopy().
+ * Nic nie robi, jeśli @p arg ma wartość NULL.
  *
- * @param prefix Pierwszy string.
- * @param suffix Drugi string.
- *
- * @return Wskaźnik na kopię lub NULL w przypadku błędu alokacji.
+ * @param mem Alokator.
+ * @param arg Zwalniany string.
  */
-static char *
-mergeStrings (const char *prefix, const char *suffix)
+static void
+arenaFreeString (struct Arena *mem, char *arg)
 {
-	char *new = malloc(strlen(prefix) + strlen(suffix) + 1);
-	if (!new) return NULL;
-	strcpy(new, prefix);
-	strcat(new, suffix);
-	return new;
+	if (arg)
+		arenaFree(mem, arg, strlen(arg) + 1);
 }
 
 /**
@@ -148,261 +364,407 @@ isDigit(int arg)
 static bool
 isNumber(const char *arg)
 {
-	if (!arg || !*arg)
-		return false;
-	for (; *arg; ++arg) {
-		if (!isDigit(*arg)) return false;
-	}
+	return arg && *arg && arg[digitsSpan(arg)] == '\0';
+}
+
+/**
+ * @brief Pakuje numer do klucza.
+ *
+ * @param[out] out Wypełniany klucz. Po użyciu należy go zwolnić funkcją
+ * freeKey().
+ * @param num Numer, dla którego isNumber() zwraca true.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+makeKey(struct Key *out, const char *num)
+{
+	out->text = num;
+	out->len = strlen(num);
+	out->digits = out->len <= KEY_INLINE ? out->buf
+	                                     : malloc(digitsSize(out->len));
+	if (!out->digits) return false;
+	digitsPack(out->digits, num, out->len);
 	return true;
 }
 
+/**
+ * @brief Zwalnia pamięć zajmowaną przez klucz.
+ *
+ * @param arg Klucz wypełniony przez makeKey().
+ */
+static void
+freeKey(struct Key *arg)
+{
+	if (arg->digits != arg->buf)
+		free(arg->digits);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Operacje na wierzcholkach
 
-static unsigned charset (const char*);
-
 /**
- * @brief Ustawia etykietę wierzchołka.
+ * @brief Zwraca etykietę wierzchołka.
  *
  * @param arg Dany wierzchołek.
- * @param label Nowa etykieta.
  */
-static void
-setLabel(rt* arg, char *label)
+static inline const uint8_t *
+labelOf(const rt *arg)
 {
-	arg->label = label;
-	arg->labelLength = label ? strlen(label) : 0;
-	arg->charset = label ? charset(label) : 0;
+	return arg->labelLength <= LABEL_INLINE ? arg->label.inl : arg->label.ptr;
 }
 
 /**
- * @brief Alokuje nowy wierzchołek drzewa słów.
+ * @brief Zwraca pierwszą cyfrę etykiety wierzchołka.
  *
- * @return Wskaźnik na nowy wierzchołek lub NULL w przypadku błędu alokacji.
+ * @param arg Dany wierzchołek, niebędący korzeniem.
  */
-static rt *
-makeRT()
+static inline unsigned
+firstDigit(const rt *arg)
 {
-	rt *new = malloc(sizeof(rt));
-	if (!new) return NULL;
-	*new = (rt){new, new, new, new, new, new, NULL, NULL, NULL, 0, 0};
-	return new;
+	return digitAt(labelOf(arg), 0);
 }
 
 /**
- * @brief Zwraca właściwy wskaźnik wskazujący na dany wierzchołek z jego lewego
- * brata/rodzica.
+ * @brief Zwalnia etykietę wierzchołka, jeśli nie jest ona przechowywana w
+ * samym wierzchołku.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
  */
-static rt **
-fromLeftSibling(rt *arg)
+static void
+freeLabel(struct Arena *mem, rt *arg)
 {
-	return arg->leftSibling->rightSibling == arg ?
-		&arg->leftSibling->rightSibling : &arg->leftSibling->rightChild;
+	if (arg->labelLength > LABEL_INLINE)
+		arenaFree(mem, arg->label.ptr, digitsSize(arg->labelLength));
 }
 
 /**
- * @brief Zwraca właściwy wskaźnik wskazujący na dany wierzchołek z jego prawego
- * brata/rodzica.
+ * @brief Ustawia etykietę wierzchołka na kopię fragmentu upakowanego ciągu.
+ * Fragment może być częścią obecnej etykiety wierzchołka.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
+ * @param src Upakowany ciąg zawierający nową etykietę.
+ * @param off Indeks pierwszej cyfry nowej etykiety w @p src.
+ * @param len Długość nowej etykiety.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ * W przypadku błędu etykieta wierzchołka się nie zmienia.
  */
-static rt **
-fromRightSibling(rt *arg)
+static bool
+setLabel(struct Arena *mem, rt* arg, const uint8_t *src, size_t off, size_t len)
 {
-	return arg->rightSibling->leftSibling == arg ?
-		&arg->rightSibling->leftSibling : &arg->rightSibling->leftChild;
+	uint8_t *old = arg->labelLength <= LABEL_INLINE ? NULL : arg->label.ptr;
+	size_t oldLength = arg->labelLength;
+	if (len <= LABEL_INLINE) {
+		uint8_t buf[LABEL_INLINE / 2];
+		digitsCopy(buf, 0, src, off, len);
+		memcpy(arg->label.inl, buf, digitsSize(len));
+	} else {
+		uint8_t *new = arenaAlloc(mem, digitsSize(len));
+		if (!new) return false;
+		digitsCopy(new, 0, src, off, len);
+		arg->label.ptr = new;
+	}
+	arenaFree(mem, old, digitsSize(oldLength));
+	arg->labelLength = len;
+	arg->charset = digitsCharset(labelOf(arg), 0, len);
+	return true;
 }
 
 /**
- * @brief Wstawia nowy wierzchołek pomiędzy wierzchołkiem danym a jego
- * rodzicem.
+ * @brief Dopisuje podany prefiks na początek etykiety wierzchołka.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
- * @param breakpoint Miejsce, w którym etykieta arg ma zostać podzielona
- * między arg i jego nowego rodzica.
+ * @param prefix Upakowany ciąg, którego początek jest dopisywany.
+ * @param prefixLen Długość prefiksu.
  *
- * @return Nowy wierzchołek lub NULL w przypadku błędu alokacji.
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ * W przypadku błędu etykieta wierzchołka się nie zmienia.
  */
-static rt *
-addAbove (rt *arg, const char* breakpoint)
+static bool
+prependLabel(struct Arena *mem, rt *arg, const uint8_t *prefix,
+             size_t prefixLen)
 {
-	rt *new = makeRT();
-	if (!new) return NULL;
-
-	setLabel(new, copyString(arg->label, breakpoint));
-	char *argLabel = copyString(breakpoint, NULL);
-	if (!new->label || !argLabel) goto alloc_error;
-
-	*fromLeftSibling(arg) = new;
-	*fromRightSibling(arg) = new;
-	new->leftSibling = arg->leftSibling;
-	new->rightSibling = arg->rightSibling;
-	new->leftChild = new->rightChild = arg;
-	arg->leftSibling = arg->rightSibling = new;
+	size_t len = prefixLen + arg->labelLength;
+	uint8_t buf[LABEL_INLINE / 2];
+	uint8_t *new = len <= LABEL_INLINE ? buf : arenaAlloc(mem, digitsSize(len));
+	if (!new) return false;
+	digitsCopy(new, 0, prefix, 0, prefixLen);
+	digitsCopy(new, prefixLen, labelOf(arg), 0, arg->labelLength);
 
-	free(arg->label);
-	setLabel(arg, argLabel);
+	freeLabel(mem, arg);
+	if (new == buf)
+		memcpy(arg->label.inl, buf, digitsSize(len));
+	else
+		arg->label.ptr = new;
+	arg->labelLength = len;
+	arg->charset = digitsCharset(new, 0, len);
+	return true;
+}
 
+/**
+ * @brief Alokuje nowy wierzchołek drzewa słów.
+ *
+ * @param mem Alokator wierzchołka.
+ *
+ * @return Wskaźnik na nowy wierzchołek lub NULL w przypadku błędu alokacji.
+ */
+static rt *
+makeRT(struct Arena *mem)
+{
+	rt *new = arenaAlloc(mem, sizeof(rt));
+	if (!new) return NULL;
+	*new = (rt){0, 0, 0, {{0}}, NULL, NULL, NULL, NULL, NULL, 0};
 	return new;
+}
 
-alloc_error:
-	free(new->label);
-	free(argLabel);
-	free(new);
-	return NULL;
+/**
+ * @brief Zwraca liczbę zapalonych bitów 16-bitowej maski.
+ * Liczy bez rozgałęzień i bez wywołań, niezależnie od dostępności
+ * instrukcji popcnt.
+ *
+ * @param mask Dana maska.
+ */
+static inline unsigned
+popcount16(unsigned mask)
+{
+	mask = mask - ((mask >> 1) & 0x5555);
+	mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+	mask = (mask + (mask >> 4)) & 0x0F0F;
+	return (mask + (mask >> 8)) & 0x1F;
 }
 
 /**
- * @brief Wstawia nowy wierzchołek jako lewego brata danego.
+ * @brief Zwraca pozycję dziecka o danej pierwszej cyfrze w tablicy dzieci.
  *
  * @param arg Dany wierzchołek.
- * @param label Etykieta nowego wierzchołka.
+ * @param digit Pierwsza cyfra etykiety dziecka.
+ */
+static inline unsigned
+childIndex(const rt *arg, unsigned digit)
+{
+	return popcount16(arg->childMask & ((1u << digit) - 1));
+}
+
+/**
+ * @brief Zwraca liczbę dzieci wierzchołka.
  *
- * @return Nowy wierzchołek lub NULL w przypadku błędu alokacji.
+ * @param arg Dany wierzchołek.
  */
-static rt *
-addLeft(rt *arg, const char *label)
+static inline unsigned
+childCount(const rt *arg)
 {
-	rt *new = makeRT();
-	if (!new) return NULL;
-	char *newLabel = copyString(label, NULL);
-	if (!newLabel) {free(new); return NULL;};
+	return popcount16(arg->childMask);
+}
 
-	*fromLeftSibling(arg) = new;
-	new->leftSibling = arg->leftSibling;
-	arg->leftSibling = new;
-	new->rightSibling = arg;
-	setLabel(new, newLabel);
+/**
+ * @brief Zwraca pojemność tablicy dzieci wystarczającą dla podanej liczby
+ * dzieci. Wierzchołki o małej liczbie dzieci mają zwartą tablicę, a gęste -
+ * tablicę na wszystkie cyfry.
+ *
+ * @param count Liczba dzieci.
+ */
+static inline unsigned
+childCapFor(unsigned count)
+{
+	return count <= 2 ? count : count <= 4 ? 4 : DIGITS;
+}
 
-	return new;
+/**
+ * @brief Zwraca wskaźnik na miejsce w tablicy dzieci rodzica, które wskazuje
+ * na dany wierzchołek.
+ *
+ * @param arg Dany wierzchołek, niebędący korzeniem.
+ */
+static inline rt **
+fromParent(rt *arg)
+{
+	rt *parent = arg->parent;
+	return &parent->children[childIndex(parent, firstDigit(arg))];
 }
 
 /**
- * @brief Wstawia nowy wierzchołek jako prawego brata danego.
+ * @brief Wstawia wierzchołek do tablicy dzieci danego wierzchołka.
+ * W razie potrzeby powiększa tablicę.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
- * @param label Etykieta nowego wierzchołka.
+ * @param child Wstawiany wierzchołek. Jego etykieta nie może zaczynać się
+ * cyfrą, dla której @p arg ma już dziecko.
  *
- * @return Nowy wierzchołek lub NULL w przypadku błędu alokacji.
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
  */
-static rt *
-addRight(rt *arg, const char *label)
+static bool
+insertChild(struct Arena *mem, rt *arg, rt *child)
 {
-	rt *new = makeRT();
-	if (!new) return NULL;
-	char *newLabel = copyString(label, NULL);
-	if (!newLabel) {free(new); return NULL;};
-
-	*fromRightSibling(arg) = new;
-	new->rightSibling = arg->rightSibling;
-	arg->rightSibling = new;
-	new->leftSibling = arg;
-	setLabel(new, newLabel);
+	unsigned digit = firstDigit(child);
+	unsigned count = childCount(arg);
+	unsigned idx = childIndex(arg, digit);
+	if (count == arg->childCap) {
+		unsigned cap = childCapFor(count + 1);
+		rt **children = arenaAlloc(mem, cap * sizeof(rt*));
+		if (!children) return false;
+		if (count) {
+			memcpy(children, arg->children, idx * sizeof(rt*));
+			memcpy(children + idx + 1, arg->children + idx,
+			       (count - idx) * sizeof(rt*));
+			arenaFree(mem, arg->children, arg->childCap * sizeof(rt*));
+		}
+		arg->children = children;
+		arg->childCap = cap;
+	} else {
+		memmove(arg->children + idx + 1, arg->children + idx,
+		        (count - idx) * sizeof(rt*));
+	}
+	arg->children[idx] = child;
+	arg->childMask |= 1u << digit;
+	child->parent = arg;
+	return true;
+}
 
-	return new;
+/**
+ * @brief Usuwa dany wierzchołek z tablicy dzieci jego rodzica.
+ * Zwalnia tablicę, jeśli rodzic nie ma już dzieci.
+ *
+ * @param mem Alokator drzewa.
+ * @param arg Dany wierzchołek, niebędący korzeniem.
+ */
+static void
+detachChild(struct Arena *mem, rt *arg)
+{
+	rt *parent = arg->parent;
+	unsigned digit = firstDigit(arg);
+	unsigned idx = childIndex(parent, digit);
+	unsigned count = childCount(parent);
+	memmove(parent->children + idx, parent->children + idx + 1,
+	        (count - idx - 1) * sizeof(rt*));
+	parent->childMask &= ~(1u << digit);
+	if (count == 1) {
+		arenaFree(mem, parent->children, parent->childCap * sizeof(rt*));
+		parent->children = NULL;
+		parent->childCap = 0;
+	}
 }
 
 /**
- * @brief Wstawia nowy wierzchołek jako jedyne dziecko danego.
+ * @brief Wstawia nowy wierzchołek pomiędzy wierzchołkiem danym a jego
+ * rodzicem.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
- * @param label Etykieta nowego wierzchołka.
+ * @param split Liczba początkowych cyfr etykiety @p arg, które mają zostać
+ * przeniesione do etykiety jego nowego rodzica.
  *
  * @return Nowy wierzchołek lub NULL w przypadku błędu alokacji.
  */
-static rt*
-addBelow(rt *arg, const char *label)
+static rt *
+addAbove (struct Arena *mem, rt *arg, size_t split)
 {
-	rt *new = makeRT();
+	rt *new = makeRT(mem);
 	if (!new) return NULL;
-	char *newLabel = copyString(label, NULL);
-	if (!newLabel) {free(new); return NULL;};
+	new->children = arenaAlloc(mem, sizeof(rt*));
+	if (!new->children) goto alloc_error;
+	new->childCap = 1;
 
-	new->leftSibling = new->rightSibling = arg;
-	arg->leftChild = arg->rightChild = new;
-	setLabel(new, newLabel);
+	if (!setLabel(mem, new, labelOf(arg), 0, split))
+		goto alloc_error;
+	rt **slot = fromParent(arg);
+	if (!setLabel(mem, arg, labelOf(arg), split, arg->labelLength - split))
+		goto alloc_error;
+
+	*slot = new;
+	new->parent = arg->parent;
+	new->children[0] = arg;
+	new->childMask = 1u << firstDigit(arg);
+	arg->parent = new;
 
 	return new;
+
+alloc_error:
+	freeLabel(mem, new);
+	arenaFree(mem, new->children, sizeof(rt*));
+	arenaFree(mem, new, sizeof(rt));
+	return NULL;
 }
 
 /**
- * @brief Wybiera dziecko, którego pierwszy znak jest zgodny z podana etykietą.
- * Jeśli takie dziecko nie istnieje, tworzone jest nowe.
+ * @brief Wybiera dziecko, którego pierwsza cyfra jest zgodna z pierwszą cyfrą
+ * podanego sufiksu klucza. Jeśli takie dziecko nie istnieje, tworzone jest
+ * nowe z etykietą równą temu sufiksowi.
  *
+ * @param mem Alokator drzewa.
  * @param arg Dany wierzchołek.
- * @param label Etykieta dziecka.
+ * @param key Klucz.
+ * @param pos Początek niepustego sufiksu klucza.
  *
  * @return Określone wyżej dziecko lub NULL w przypadku błędu alokacji.
  */
 static rt *
-addChild(rt *arg, const char *label)
+addChild(struct Arena *mem, rt *arg, const struct Key *key, size_t pos)
 {
-	if (arg->leftChild == arg) {
-		return addBelow(arg, label);
-	} else {
-		rt *child = arg->rightChild;
-		for (;child != arg; child = child->rightSibling) {
-			if (child->label[0] == label[0])
-				return child;
-			if (child->label[0] > label[0])
-				break;
-		}
-		return child == arg ? addRight(arg->leftChild, label)
-		                    : addLeft(child, label);
-	}
+	unsigned digit = digitAt(key->digits, pos);
+	if (arg->childMask >> digit & 1)
+		return arg->children[childIndex(arg, digit)];
+
+	rt *new = makeRT(mem);
+	if (!new) return NULL;
+	if (!setLabel(mem, new, key->digits, pos, key->len - pos))
+		goto alloc_error;
+	if (!insertChild(mem, arg, new))
+		goto alloc_error;
+	return new;
+
+alloc_error:
+	freeLabel(mem, new);
+	arenaFree(mem, new, sizeof(rt));
+	return NULL;
 }
 
 /**
- * @brief Wybiera dziecko, którego pierwszy znak jest zgodny z podana etykietą.
+ * @brief Wybiera dziecko, którego etykieta zaczyna się podaną cyfrą.
  *
  * @param arg Dany wierzchołek.
- * @param label Etykieta dziecka.
+ * @param digit Pierwsza cyfra etykiety dziecka.
  *
  * @return Określone wyżej dziecko lub NULL jeśli takie dziecko nie istnieje.
  */
-static rt *
-selectChild(rt *arg, const char *label)
+static inline rt *
+selectChild(rt *arg, unsigned digit)
 {
-	for (rt *c = arg->rightChild; c != arg; c = c->rightSibling) {
-		if (c->label[0] == label[0])
-			return c;
-		if (c->label[0] > label[0])
-			break;
-	}
-	return NULL;
+	if (!(arg->childMask >> digit & 1))
+		return NULL;
+	return arg->children[childIndex(arg, digit)];
 }
 
 /**
  * @brief Wycina podany wierzchołek ze drzewa.
  *
+ * @param mem Alokator drzewa.
  * @param arg Wycinany wierzchołek.
  *
  * @return true, jeśli wycinanie się powiodło, lub false, jeśli zostało ono
  * uniemożliwione błędem alokacji.
  */
 static bool
-removeFromTree(rt *arg) {
-	if (arg->leftChild == arg) {
-		*fromLeftSibling(arg) = arg->rightSibling;
-		*fromRightSibling(arg) = arg->leftSibling;
-		free(arg->label);
-	} else if (arg->leftChild == arg->rightChild) {
-		rt *child = arg->leftChild;
-		char *newLabel = mergeStrings(arg->label, child->label);
-		if (!newLabel)
+removeFromTree(struct Arena *mem, rt *arg) {
+	if (!arg->childMask) {
+		detachChild(mem, arg);
+		freeLabel(mem, arg);
+	} else if (childCount(arg) == 1) {
+		rt *child = arg->children[0];
+		rt **slot = fromParent(arg);
+		if (!prependLabel(mem, child, labelOf(arg), arg->labelLength))
 			return false;
 
-		*fromLeftSibling(arg) = child;
-		*fromRightSibling(arg) = child;
-		child->leftSibling = arg->leftSibling;
-		child->rightSibling = arg->rightSibling;
+		*slot = child;
+		child->parent = arg->parent;
 
-		free(arg->label);
-		free(child->label);
-		setLabel(child, newLabel);
+		arenaFree(mem, arg->children, arg->childCap * sizeof(rt*));
+		freeLabel(mem, arg);
 	}
 	return true;
 }
@@ -412,557 +774,4684 @@ removeFromTree(rt *arg) {
  *
  * @param arg Dany wierzchołek;
  */
-static inline bool isRoot (rt *arg) {return arg->leftSibling == arg;}
-
-/**
- * @brief Zwraca rodzica podanego wierzchołka, o ile jest on skrajnym dzieckiem.
- *
- * @param arg Podany wierzchołek.
- *
- * @return Rodzic @p arg, jeśli @p arg jest skrajnym dzieckiem
- * i nie jest korzeniem. W przeciwnym razie NULL.
- */
-static rt *
-getParent (rt *arg)
-{
-	if (arg->leftSibling->rightSibling != arg)
-		return arg->leftSibling;
-	else if (arg->rightSibling->leftSibling != arg)
-		return arg->rightSibling;
-	else
-		return NULL;
-}
+static inline bool isRoot (rt *arg) {return arg->parent == NULL;}
 
 /**
  * @brief Usuwa zbędny wierzchołek z drzewa i z pamięci.
  *
- * Sprawdza, czy @p arg znajduje się w cyklu przekierowań lub jest korzeniem.
+ * Sprawdza, czy @p arg jest przekierowany, są na niego przekierowane jakieś
+ * słowa lub jest korzeniem.
  * Jeśli nie, zwalnia jego fullWord (jeśli istnieje). Jeśli
  * ponadto @p arg posiada co najwyżej jedno dziecko, zostaje uznany za zbędny i
  * usunięty z drzewa i z pamięci, o ile nie uniemożliwią tego błędy alokacji.
  *
+ * @param mem Alokator drzewa.
  * @param arg Podany wierzchołek.
  */
 static void
-cleanup (rt* arg)
+cleanup (struct Arena *mem, rt* arg)
 {
-	if (isRoot(arg) || arg->leftRev != arg)
+	if (isRoot(arg) || arg->fwd || arg->sources)
 		return;
 	if (arg->fullWord) {
-		free(arg->fullWord);
+		arenaFreeString(mem, arg->fullWord);
 		arg->fullWord = NULL;
 	}
-	if (arg->leftChild != arg->rightChild) {
+	if (childCount(arg) > 1) {
 		return;
 	}
 
-	rt *parent = getParent(arg);
-	if (!removeFromTree(arg))
+	rt *parent = arg->parent;
+	if (!removeFromTree(mem, arg))
 		return;
 
-	free(arg);
-
-	if (parent)
-		cleanup(parent);
+	arenaFree(mem, arg, sizeof(rt));
+	cleanup(mem, parent);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Zliczanie numerów nietrywialnych
+
 /**
- * @brief Dodaje słowo z "from" do cyklu przekierowań słowa z "to".
+ * @brief Zwraca zbiór cyfr w napisie zakodowany w formie bitowej.
+ * n-ty najmniej znaczący bit w wyniku jest zapalony wtedy i tylko wtedy,
+ * gdy n-ta cyfra należy do @p arg.
  *
- * @param src Dodawane słowo z drzewa "from".
- * @param fwd Słowo z drzewa "to".
+ * @param arg Dany napis.
+ *
+ * @return Zakodowany zbiór cyfr należacych do @p arg.
  */
-static void
-addAsRev(rt *src, rt *fwd)
+static unsigned
+charset (const char *arg)
 {
-	src->leftRev = fwd;
-	src->rightRev = fwd->rightRev;
-	src->rightRev->leftRev = src;
-	src->leftRev->rightRev = src;
-	src->fwd = fwd;
+	unsigned acc = 0;
+	while (*arg) {
+		if (isDigit(*arg)) acc |= 1 << (*arg - '0');
+		++arg;
+	}
+	return acc;
 }
 
 /**
- * @brief Usuwa słowo z "from" z jego cyklu przekierowań.
+ * @brief Zwraca moc zbioru cyfr zakodowanego przez charset().
  *
- * @param src Usuwane słowo z drzewa "from".
+ * @param charset Zakodowany przez charset() zbiór cyfr.
+ *
+ * @return Moc zbioru @p charset.
  */
-static void
-removeAsRev(rt *src)
+static unsigned
+charset_size (unsigned charset)
 {
-	src->leftRev->rightRev = src->rightRev;
-	src->rightRev->leftRev = src->leftRev;
-	src->leftRev = src->rightRev = src;
+	unsigned acc = 0;
+	while (charset) {
+		acc += (charset & 1);
+		charset >>= 1;
+	}
+	return acc;
 }
 
-
-////////////////////////////////////////////////////////////////////////////////
-// Operacje na słowach
-
 /**
- * @brief Dodaje słowo do drzewa.
- *
- * @param arg Korzeń drzewa, do którego dodawane ma zostać dodane słowo.
- * @param key Dodawane słowo.
+ * @brief Sprawdza, czy @p sub jest podzbiorem @p super
  *
- * @return Wierzchołek odpowiadający dodawanemu słowu lub NULL w przypadku błędu
- * alokacji.
+ * @param sub Zbiór zakodowany przez charset().
+ * @param super Zbiór zakodowany przez charset().
  */
-static rt *
-addKey (rt* arg, const char *key)
+static bool
+subset (unsigned sub, unsigned super)
 {
-	rt *child = addChild(arg, key);
-	if (!child) return NULL;
-	const char *label = child->label;
-	while (*key == *label && *key && *label) {++key; ++label;}
-	if (*key == '\0' && *label == '\0') {
-		return child;
-	} else if (*key == '\0' && *label != '\0') {
-		return addAbove(child, label);
-	} else if (*key != '\0' && *label != '\0') {
-		rt *fork = addAbove(child, label);
-		if (!fork) return NULL;
-		return addChild(fork, key);
-	} else {
-		return addKey(child, key);
-	}
+	return (sub & super) == sub;
 }
 
 /**
- * @brief Znajduje poddrzewo słów o podanym prefiksie.
+ * @brief Funkcja potęgująca.
  *
- * @param arg Korzeń przeszukiwanego drzewa.
- * @param key Szukany prefiks.
+ * @param base Podstawa.
+ * @param exp Wykładnik.
  *
- * @return Korzeń poddrzewa drzewa @p arg o prefiksie @p key, jeśli takie
- * poddrzewo istnieje, lub NULL.
+ * @return Wynik potęgowania @p base do @p exp.
  */
-static rt *
-getBranch (rt* arg, const char *key)
+static size_t
+power(size_t base, size_t exp)
 {
-	rt *child = selectChild(arg, key);
-	if (!child)
-		return NULL;
-
-	const char *label = child->label;
-	while (*key == *label && *key && *label) {++key; ++label;}
-	if (!*key) {
-		return child;
-	} else if (!*label) {
-		return getBranch(child, key);
-	} else {
-		return NULL;
-	}
+	size_t ret = 1;
+	while (exp) {ret *= exp%2 ? base : 1; exp /= 2; base *= base;}
+	return ret;
 }
 
 /**
- * @brief Usuwa podane poddrzewo z drzewa "from".
+ * @brief Zwalnia pamięć zajmowaną przez liczniki.
  *
- * @param arg Korzeń usuwanego poddrzewa.
+ * @param arg Liczniki.
  */
 static void
-removeBranchRec (rt* arg)
+countIndexFree(struct CountIndex *arg)
 {
-	if (arg->fwd != NULL) {
-		removeAsRev(arg);
-		cleanup(arg->fwd);
-		arg->fwd = NULL;
+	for (size_t d = 0; d < arg->depth; ++d)
+		free(arg->levels[d].terms);
+	free(arg->levels);
+	arg->levels = NULL;
+	arg->depth = 0;
+}
+
+/**
+ * @brief Wyszukuje licznik słów o danej długości i zbiorze cyfr.
+ *
+ * @param arg Liczniki.
+ * @param depth Długość słów.
+ * @param mask Zakodowany przez charset() zbiór cyfr.
+ *
+ * @return Wskaźnik na licznik lub NULL, jeśli nie istnieje.
+ */
+static size_t *
+countFind(struct CountIndex *arg, size_t depth, unsigned mask)
+{
+	if (depth >= arg->depth) return NULL;
+	struct CountLevel *level = &arg->levels[depth];
+	size_t lo = 0, hi = level->size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (level->terms[mid].mask < mask)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
+	if (lo < level->size && level->terms[lo].mask == mask)
+		return &level->terms[lo].count;
+	return NULL;
+}
 
-	for (rt *c = arg->rightChild; c != arg;) {
-		rt *tmp = c->rightSibling;
-		removeBranchRec(c);
-		c = tmp;
+/**
+ * @brief Tworzy zerowy licznik słów o danej długości i zbiorze cyfr, jeśli
+ * jeszcze nie istnieje. Liczniki nie są usuwane, więc później zmiana ich
+ * wartości nie wymaga alokacji.
+ *
+ * @param arg Liczniki.
+ * @param depth Długość słów.
+ * @param mask Zakodowany przez charset() zbiór cyfr.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+countReserve(struct CountIndex *arg, size_t depth, unsigned mask)
+{
+	if (countFind(arg, depth, mask))
+		return true;
+	if (depth >= arg->depth) {
+		size_t newDepth = 2 * arg->depth > depth ? 2 * arg->depth : depth + 1;
+		struct CountLevel *new = realloc(arg->levels,
+		                                 newDepth * sizeof(struct CountLevel));
+		if (!new) return false;
+		for (size_t d = arg->depth; d < newDepth; ++d)
+			new[d] = (struct CountLevel){NULL, 0, 0};
+		arg->levels = new;
+		arg->depth = newDepth;
 	}
 
-	free(arg->label);
-	if (arg->fullWord)
-		free(arg->fullWord);
-	free(arg);
+	struct CountLevel *level = &arg->levels[depth];
+	if (level->size == level->cap) {
+		size_t cap = level->cap ? 2 * level->cap : 4;
+		struct CountTerm *new = realloc(level->terms,
+		                                cap * sizeof(struct CountTerm));
+		if (!new) return false;
+		level->terms = new;
+		level->cap = cap;
+	}
+	size_t pos = level->size;
+	while (pos > 0 && level->terms[pos - 1].mask > mask) {
+		level->terms[pos] = level->terms[pos - 1];
+		--pos;
+	}
+	level->terms[pos] = (struct CountTerm){mask, 0};
+	++level->size;
+	return true;
 }
 
 /**
- * @brief Usuwa z danego drzewa "from" wszystkie słowa o podanym prefiksie.
+ * @brief Zmienia licznik słowa, na które istnieją przekierowania.
+ * Licznik musi istnieć (patrz countReserve()).
  *
- * @param arg Korzeń drzewa "from".
- * @param prefix Prefix, którego wszystkie rozwinięcia mają zostać usunięte.
+ * @param arg Liczniki.
+ * @param word Wierzchołek drzewa "to" z ustalonym fullWord.
+ * @param delta Zmiana licznika.
  */
 static void
-removeBranch (rt* arg, const char *prefix)
+countAdd(struct CountIndex *arg, const rt *word, size_t delta)
 {
-	rt *root = getBranch(arg, prefix);
-	if (!root)
-		return;
-
-	*fromLeftSibling(root) = root->rightSibling;
-	*fromRightSibling(root) = root->leftSibling;
-	removeBranchRec(root);
+	*countFind(arg, strlen(word->fullWord), charset(word->fullWord)) += delta;
 }
 
 /**
- * @brief Usuwa całe drzewo.
+ * @brief Zmienia liczniki najpłytszych słów poddrzewa, na które istnieją
+ * przekierowania, z pominięciem korzenia poddrzewa.
  *
- * @param arg Korzeń usuwanego drzewa.
+ * @param arg Liczniki.
+ * @param root Korzeń poddrzewa drzewa "to".
+ * @param delta Zmiana liczników.
  */
 static void
-deleteRec (rt *arg) {
-	for (rt *c = arg->rightChild; c != arg;) {
-		rt *tmp = c->rightSibling;
-		deleteRec(c);
-		c = tmp;
-	}
-	free(arg->label);
-	if (arg->fullWord)
-		free(arg->fullWord);
-	free(arg);
+countSubtree(struct CountIndex *arg, const rt *root, size_t delta)
+{
+	for (unsigned i = 0; i < childCount(root); ++i) {
+		const rt *c = root->children[i];
+		if (c->sources)
+			countAdd(arg, c, delta);
+		else
+			countSubtree(arg, c, delta);
+	}
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// Sortowanie leksykograficzne
+/**
+ * Długość, dla której należy wyznaczyć wynik zapytania wsadowego
+ * phfwdNonTrivialCountBatch().
+ */
+struct LenQuery {
+	size_t len; ///< Długość.
+	size_t idx; ///< Indeks długości w danych wejściowych.
+};
 
 /**
- * @brief Tworzy nowe drzewo sortujące.
- *
- * @param key Pierwsze słowo w nowym drzewie sortującym.
+ * Zbiór cyfr zapytania wsadowego phfwdNonTrivialCountBatch() wraz z
+ * obliczaną dla niego wartością.
+ */
+struct SetQuery {
+	unsigned mask; ///< Zakodowany przez charset() zbiór cyfr S.
+	size_t base; ///< Moc zbioru S.
+	/** Suma po długościach e <= d liczby minimalnych słów długości e
+	 * o cyfrach z S razy |S|^(d - e) dla bieżącej długości d. */
+	size_t horner;
+};
+
+/**
+ * @brief Porównuje zapytania o długości według długości.
  *
- * @return Nowe drzewo sortujące lub NULL w przypadku błędu alokacji.
+ * @param a Pierwsze zapytanie.
+ * @param b Drugie zapytanie.
  */
-static rt *
-makeSorter(const char *key)
+static int
+lenOrder(const void *a, const void *b)
 {
-	rt *sorter = makeRT();
-	if (!sorter) return NULL;
-	sorter->label = calloc(1,1);
-	if (!sorter->label) {free(sorter); return NULL;}
-	rt *k = addKey (sorter, key);
-	if (!k) {deleteRec(sorter); return NULL;}
-	k->fullWord = copyString(key, NULL);
-	if (!k->fullWord) {deleteRec(sorter); return NULL;}
-	return sorter;
+	size_t x = ((const struct LenQuery*)a)->len;
+	size_t y = ((const struct LenQuery*)b)->len;
+	return (x > y) - (x < y);
 }
 
 /**
- * @brief Wypisuje do struktury PhoneNumbers wszystkie słowa zapisane w
- * drzewie w kolejności leksykograficznej.
+ * @brief Sprawdza, czy na jakiś właściwy prefiks słowa istnieją
+ * przekierowania.
  *
- * @param arg Drzewo do wypisania.
- * @param[out] p Struktura, do której drzewo jest wypisywane.
+ * @param arg Wierzchołek drzewa "to".
  */
-static void
-prefixOrder(rt *arg, struct PhoneNumbers *p)
+static bool
+hasRevAncestor(const rt *arg)
 {
-	if (arg->fullWord)
-		p->data[p->size++] = arg->fullWord;
-	for (rt *c = arg->rightChild; c != arg; c = c->rightSibling) {
-		prefixOrder(c, p);
+	for (arg = arg->parent; arg; arg = arg->parent) {
+		if (arg->sources)
+			return true;
 	}
-
+	return false;
 }
 
 /**
- * @brief Usuwa drzewo sortujące.
+ * @brief Aktualizuje liczniki, gdy na słowo pojawia się pierwsze
+ * przekierowanie. Słowo staje się minimalne, a minimalne słowa w jego
+ * poddrzewie przestają nimi być.
  *
- * @param arg Usuwane drzewo sortujące.
- * @see prefixOrder
+ * @param arg Liczniki, w których istnieje licznik dla słowa.
+ * @param word Wierzchołek drzewa "to" z ustalonym fullWord.
  */
 static void
-deleteSorter (rt *arg) {
-	for (rt *c = arg->rightChild; c != arg;) {
-		rt *tmp = c->rightSibling;
-		deleteSorter(c);
-		c = tmp;
-	}
-	free(arg->label);
-	free(arg);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// Implementacja interfejsu
-
-struct PhoneForward *
-phfwdNew(void)
+countGain(struct CountIndex *arg, const rt *word)
 {
-	struct PhoneForward *new = malloc(sizeof(struct PhoneForward));
-	if (!new) return NULL;
-	new->from = makeRT();
-	new->to = makeRT();
-	if (!new->to || !new->from) goto alloc_error_1;
-	new->from->label = calloc(1,1);
-	new->to->label = calloc(1,1);
-	if (!new->to->label || !new->from->label) goto alloc_error_2;
-	return new;
-
-alloc_error_2:
-	free(new->from->label);
-	free(new->to->label);
-alloc_error_1:
-	free(new->to);
-	free(new->from);
-	free(new);
-	return NULL;
+	if (hasRevAncestor(word))
+		return;
+	countSubtree(arg, word, (size_t)-1);
+	countAdd(arg, word, 1);
 }
 
-void
-phfwdDelete(struct PhoneForward *arg)
+/**
+ * @brief Aktualizuje liczniki, gdy znika ostatnie przekierowanie na słowo.
+ *
+ * @param arg Liczniki.
+ * @param word Wierzchołek drzewa "to" z ustalonym fullWord.
+ */
+static void
+countLose(struct CountIndex *arg, const rt *word)
 {
-	if (!arg)
+	if (hasRevAncestor(word))
 		return;
-	deleteRec(arg->from);
-	deleteRec(arg->to);
-	free(arg);
+	countAdd(arg, word, (size_t)-1);
+	countSubtree(arg, word, 1);
 }
 
-bool
-phfwdAdd(struct PhoneForward *arg, char const *num1, char const *num2)
-{
-	if (!arg || !isNumber(num1) || !isNumber(num2) || !strcmp(num1, num2))
-		return false;
-	rt *key1 = addKey(arg->from, num1);
-	rt *key2 = addKey(arg->to, num2);
-	if (!key1 || !key2) return false;
-	if (key1->fwd == key2) return true;
 
-	if (!key1->fullWord) key1->fullWord = copyString(num1, NULL);
-	if (!key2->fullWord) key2->fullWord = copyString(num2, NULL);
-	if (!key1->fullWord || !key2->fullWord) return false;
+////////////////////////////////////////////////////////////////////////////////
+// Przekierowania
 
-	rt *oldFwd = key1->fwd;
-	removeAsRev(key1);
-	addAsRev(key1, key2);
-	if (oldFwd)
-		cleanup(oldFwd);
-	return true;
+/**
+ * @brief Zwraca rozmiar wektora słów o podanej pojemności.
+ *
+ * @param cap Pojemność wektora.
+ */
+static inline size_t
+sourcesSize(size_t cap)
+{
+	return sizeof(struct Sources) + cap * sizeof(struct Source);
 }
 
-void
-phfwdRemove(struct PhoneForward *arg, const char *key)
+/**
+ * @brief Porównuje napis z prefiksem innego napisu.
+ *
+ * @param a Porównywany napis.
+ * @param b Napis, którego prefiks jest porównywany.
+ * @param len Długość prefiksu, nie większa niż długość @p b.
+ *
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp().
+ */
+static int
+compareN(const char *a, const char *b, size_t len)
 {
-	if (!arg) return;
-	if (!isNumber(key))
-		return;
-	removeBranch(arg->from, key);
+	int ret = strncmp(a, b, len);
+	return ret ? ret : a[len] != '\0';
 }
 
-const struct PhoneNumbers *
-phfwdGet(struct PhoneForward *argpf, char const *key)
+/**
+ * @brief Wyszukuje binarnie miejsce słowa w wektorze.
+ *
+ * @param arg Wektor słów.
+ * @param word Napis, którego prefiks jest szukanym słowem.
+ * @param len Długość szukanego słowa.
+ *
+ * @return Indeks pierwszego słowa nie mniejszego niż szukane.
+ */
+static size_t
+sourceLowerBound(const struct Sources *arg, const char *word, size_t len)
 {
-	if (!argpf) return NULL;
-	rt *arg = argpf->from;
-	if (!isNumber(key)) {
-		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
-		if (!new) return NULL;
-		new->size = 0;
-		return new;
+	size_t lo = 0, hi = arg->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (compareN(arg->item[mid].word, word, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-
-	const char *bestPrefix = "";
-	const char *bestSuffix = key;
-	while (1) {
-		if (arg->fwd) {
-			bestPrefix = arg->fwd->fullWord;
-			bestSuffix = key;
-		}
-		if (key[0] == '\0') break;
-
-		rt *child = selectChild(arg, key);
-		if (!child)
-			break;
-		const char *label = child->label;
-		while (*key == *label && *key && *label) {++key; ++label;}
-		if (label[0] == '\0') {
-			arg = child;
-		} else {
-			break;
-		}
-	}
-	struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers)
-	                                  + sizeof(char*));
-	if (!new) return NULL;
-	new->size = 1;
-	new->data[0] = mergeStrings(bestPrefix, bestSuffix);
-	if (!new->data[0]) {free(new); return NULL;}
-	return new;
+	return lo;
 }
 
 /**
- * @brief Wpisuje wszystkie słowa określone w phfwdReverse() do drzewa
- * sortującego.
+ * @brief Przekierowuje słowo z "from" na słowo z "to".
  *
- * @param arg Drzewo "to".
- * @param key Słowo podane w phfwdReverse.
- * @param[out] acc Drzewo sortujące.
- * @param counter Obecna liczba słów zapisanych w @p acc.
+ * @param pf Struktura przechowująca przekierowania.
+ * @param src Przekierowywane słowo z drzewa "from".
+ * @param fwd Słowo z drzewa "to" z ustalonym fullWord.
  *
- * @return Zaktualizowana liczba słów w @p acc. Jeśli wystąpił błąd alokacji,
- * zwraca -1.
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
  */
-static int
-reverseRev(rt *arg, const char *key, rt *acc, size_t counter) {
-	for (rt *r = arg->rightRev; r != arg; r = r->rightRev) {
-		char *combined = mergeStrings(r->fullWord, key);
-		if (!combined) return -1;
-		rt *k = addKey (acc, combined);
-		if (!k) {free(combined); return -1;}
-		if (!k->fullWord) {
-			k->fullWord = combined;
-			++counter;
+static bool
+addAsRev(struct PhoneForward *pf, rt *src, rt *fwd)
+{
+	struct Arena *mem = &pf->mem;
+	struct Sources *vec = fwd->sources;
+	if (!vec && !countReserve(&pf->counts, strlen(fwd->fullWord),
+	                          charset(fwd->fullWord)))
+		return false;
+	if (!vec || vec->count == vec->cap) {
+		size_t cap = vec ? 2 * vec->cap : 1;
+		struct Sources *new = arenaAlloc(mem, sourcesSize(cap));
+		if (!new) return false;
+		if (vec) {
+			memcpy(new, vec, sourcesSize(vec->count));
+			arenaFree(mem, vec, sourcesSize(vec->cap));
 		} else {
-			free(combined);
+			new->count = new->bytes = 0;
+		}
+		new->cap = cap;
+		fwd->sources = new;
+		if (!vec) {
+			countGain(&pf->counts, fwd);
+			++pf->targets;
 		}
+		vec = new;
 	}
 
-	if (key[0] == '\0') return counter;
-	rt *child = selectChild(arg, key);
-	if (!child)
-		return counter;
-
-	const char *label = child->label;
-	while (*key == *label && *key && *label) {++key; ++label;}
-	if (label[0] == '\0') {
-		return reverseRev(child, key, acc, counter);
-	} else {
-		return counter;
-	}
+	size_t idx = sourceLowerBound(vec, src->fullWord, strlen(src->fullWord));
+	memmove(vec->item + idx + 1, vec->item + idx,
+	        (vec->count - idx) * sizeof(struct Source));
+	vec->item[idx] = (struct Source){src->fullWord, src};
+	++vec->count;
+	vec->bytes += strlen(src->fullWord);
+	src->fwd = fwd;
+	return true;
 }
 
-const struct PhoneNumbers *
-phfwdReverse(struct PhoneForward *arg, char const *key)
+/**
+ * @brief Usuwa fragment wektora słów przekierowanych na @p fwd i zeruje
+ * przekierowania usuniętych słów.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param fwd Słowo z drzewa "to".
+ * @param begin Indeks pierwszego usuwanego słowa.
+ * @param end Indeks za ostatnim usuwanym słowem.
+ */
+static void
+eraseSources(struct PhoneForward *pf, rt *fwd, size_t begin, size_t end)
 {
-	if (!arg) return NULL;
-	if (!isNumber(key)) {
-		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
-		if (!new) return NULL;
-		new->size = 0;
-		return new;
+	struct Sources *vec = fwd->sources;
+	for (size_t i = begin; i < end; ++i) {
+		vec->item[i].node->fwd = NULL;
+		vec->bytes -= strlen(vec->item[i].word);
+	}
+	memmove(vec->item + begin, vec->item + end,
+	        (vec->count - end) * sizeof(struct Source));
+	vec->count -= end - begin;
+	if (vec->count == 0) {
+		arenaFree(&pf->mem, vec, sourcesSize(vec->cap));
+		fwd->sources = NULL;
+		countLose(&pf->counts, fwd);
+		--pf->targets;
 	}
-
-	rt *sorter = makeSorter(key);
-	if (!sorter) return NULL;
-	int size = reverseRev(arg->to, key, sorter, 0) + 1;
-	struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers) +
-	                                  size * sizeof(char*));
-	if (size == 0 || !new) {deleteRec(sorter); free(new); return NULL;}
-	new->size = 0;
-	prefixOrder(sorter, new);
-	deleteSorter(sorter);
-	return new;
 }
 
-char const *
-phnumGet(const struct PhoneNumbers *arg, size_t idx)
+/**
+ * @brief Usuwa przekierowanie słowa z "from".
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param src Słowo z drzewa "from" przekierowane na @p fwd.
+ * @param fwd Słowo z drzewa "to".
+ */
+static void
+removeAsRev(struct PhoneForward *pf, rt *src, rt *fwd)
 {
-	if (!arg) return NULL;
-	return idx < arg->size ? arg->data[idx] : NULL;
+	size_t idx = sourceLowerBound(fwd->sources, src->fullWord,
+	                              strlen(src->fullWord));
+	eraseSources(pf, fwd, idx, idx + 1);
 }
 
-void
-phnumDelete(const struct PhoneNumbers *arg)
+/**
+ * @brief Usuwa przekierowania na @p fwd wszystkich słów o podanym prefiksie.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param fwd Słowo z drzewa "to".
+ * @param prefix Prefiks słów, których przekierowania są usuwane.
+ * @param len Długość prefiksu.
+ */
+static void
+removePrefixAsRev(struct PhoneForward *pf, rt *fwd, const char *prefix,
+                  size_t len)
 {
-	if (!arg) return;
-	for (size_t i = 0; i < arg->size; ++i)
-		free((void*)arg->data[i]);
-	free((void*)arg);
+	const struct Sources *vec = fwd->sources;
+	size_t begin = sourceLowerBound(vec, prefix, len);
+	size_t end = begin;
+	while (end < vec->count && !strncmp(vec->item[end].word, prefix, len))
+		++end;
+	eraseSources(pf, fwd, begin, end);
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Operacje na słowach
+
 /**
- * @brief Zwraca zbiór cyfr w napisie zakodowany w formie bitowej.
- * n-ty najmniej znaczący bit w wyniku jest zapalony wtedy i tylko wtedy,
- * gdy n-ta cyfra należy do @p arg.
- *
- * @param arg Dany napis.
+ * @brief Zwraca długość wspólnego prefiksu etykiety wierzchołka i sufiksu
+ * klucza.
  *
- * @return Zakodowany zbiór cyfr należacych do @p arg.
+ * @param arg Dany wierzchołek.
+ * @param key Klucz.
+ * @param pos Początek sufiksu klucza.
  */
-static unsigned
-charset (const char *arg)
+static inline size_t
+matchLabel(const rt *arg, const struct Key *key, size_t pos)
 {
-	unsigned acc = 0;
-	while (*arg) {
-		if (isDigit(*arg)) acc |= 1 << (*arg - '0');
-		++arg;
-	}
-	return acc;
+	size_t len = key->len - pos;
+	if (len > arg->labelLength)
+		len = arg->labelLength;
+	return digitsCommonPrefix(labelOf(arg), 0, key->digits, pos, len);
 }
 
 /**
- * @brief Zwraca moc zbioru cyfr zakodowanego przez charset().
+ * @brief Dodaje słowo do drzewa.
  *
- * @param charset Zakodowany przez charset() zbiór cyfr.
+ * @param mem Alokator drzewa.
+ * @param arg Korzeń drzewa, do którego dodawane ma zostać dodane słowo.
+ * @param key Dodawane słowo.
+ * @param pos Początek niepustego sufiksu @p key, który ma zostać dodany
+ * poniżej @p arg.
  *
- * @return Moc zbioru @p charset.
+ * @return Wierzchołek odpowiadający dodawanemu słowu lub NULL w przypadku błędu
+ * alokacji.
  */
-static unsigned
-charset_size (unsigned charset)
+static rt *
+addKey (struct Arena *mem, rt* arg, const struct Key *key, size_t pos)
 {
-	unsigned acc = 0;
-	while (charset) {
-		acc += (charset & 1);
-		charset >>= 1;
+	rt *child = addChild(mem, arg, key, pos);
+	if (!child) return NULL;
+	size_t common = matchLabel(child, key, pos);
+	pos += common;
+	if (common == child->labelLength) {
+		return pos == key->len ? child : addKey(mem, child, key, pos);
 	}
-	return acc;
+	rt *fork = addAbove(mem, child, common);
+	if (!fork || pos == key->len) return fork;
+	return addChild(mem, fork, key, pos);
 }
 
 /**
- * @brief Sprawdza, czy @p sub jest podzbiorem @p super
+ * @brief Znajduje poddrzewo słów o podanym prefiksie.
  *
- * @param sub Zbiór zakodowany przez charset().
- * @param super Zbiór zakodowany przez charset().
+ * @param arg Korzeń przeszukiwanego drzewa.
+ * @param key Szukany prefiks.
+ * @param pos Początek niepustego sufiksu @p key, który ma być szukany
+ * poniżej @p arg.
+ *
+ * @return Korzeń poddrzewa drzewa @p arg o prefiksie @p key, jeśli takie
+ * poddrzewo istnieje, lub NULL.
  */
-static bool
-subset (unsigned sub, unsigned super)
+static rt *
+getBranch (rt* arg, const struct Key *key, size_t pos)
 {
-	return (sub & super) == sub;
-}
-
+	rt *child = selectChild(arg, digitAt(key->digits, pos));
+	if (!child)
+		return NULL;
 
-/**
- * @brief Funkcja potęgująca.
+	size_t common = matchLabel(child, key, pos);
+	pos += common;
+	if (pos == key->len) {
+		return child;
+	} else if (common == child->labelLength) {
+		return getBranch(child, key, pos);
+	} else {
+		return NULL;
+	}
+}
+
+/**
+ * @brief Usuwa podane poddrzewo z drzewa "from".
+ * Zwolnione wierzchołki wracają na listy wolnych bloków areny.
+ * Wszystkie słowa poddrzewa przekierowane na ten sam wierzchołek zajmują
+ * spójny fragment jego wektora, więc są z niego usuwane naraz przy
+ * pierwszym z nich.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param arg Korzeń usuwanego poddrzewa.
+ * @param prefix Słowo, którego rozwinięciami są wszystkie słowa poddrzewa.
+ */
+static void
+removeBranchRec (struct PhoneForward *pf, rt* arg, const struct Key *prefix)
+{
+	struct Arena *mem = &pf->mem;
+	if (arg->fwd != NULL) {
+		rt *fwd = arg->fwd;
+		removePrefixAsRev(pf, fwd, prefix->text, prefix->len);
+		cleanup(mem, fwd);
+	}
+
+	for (unsigned i = 0; i < childCount(arg); ++i)
+		removeBranchRec(pf, arg->children[i], prefix);
+
+	arenaFree(mem, arg->children, arg->childCap * sizeof(rt*));
+	freeLabel(mem, arg);
+	arenaFreeString(mem, arg->fullWord);
+	arenaFree(mem, arg, sizeof(rt));
+}
+
+/**
+ * @brief Usuwa z danego drzewa "from" wszystkie słowa o podanym prefiksie.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param prefix Prefix, którego wszystkie rozwinięcia mają zostać usunięte.
+ */
+static void
+removeBranch (struct PhoneForward *pf, const struct Key *prefix)
+{
+	rt *root = getBranch(pf->from, prefix, 0);
+	if (!root)
+		return;
+
+	detachChild(&pf->mem, root);
+	removeBranchRec(pf, root, prefix);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalanie wyników wyszukiwania odwrotnego
+//
+// Wynikami phfwdReverse() są konkatenacje w + s, gdzie w jest słowem
+// przekierowanym na wierzchołek ze ścieżki numeru w drzewie "to", a s jest
+// sufiksem numeru za tym wierzchołkiem. Dla ustalonego wierzchołka sufiks jest
+// wspólny, a słowa są posortowane, więc konkatenacje są posortowane z jednym
+// wyjątkiem: jeśli słowo jest prefiksem następnego, kolejność może się
+// odwrócić. Takie słowa są odkładane do kopca jako osobne ciągi
+// jednoelementowe, a pozostałe ciągi są scalane przez kopiec bez sortowania.
+
+/**
+ * Posortowany ciąg wyników: bieżący wynik oraz słowa pozostałe do
+ * wygenerowania.
+ */
+struct RevRun {
+	const char *word; ///< Słowo bieżącego wyniku.
+	const char *suffix; ///< Sufiks wspólny dla wszystkich wyników ciągu.
+	const struct Source *next; ///< Następne słowo ciągu.
+	const struct Source *end; ///< Koniec słów ciągu.
+};
+
+/**
+ * Stan scalania ciągów wyników phfwdReverse().
+ */
+struct RevMerge {
+	struct RevRun *heap; ///< Kopiec ciągów według bieżących wyników.
+	size_t size; ///< Liczba ciągów w kopcu.
+	size_t cap; ///< Pojemność kopca.
+	const char *lastWord; ///< Słowo ostatniego zwróconego wyniku lub NULL.
+	const char *lastSuffix; ///< Sufiks ostatniego zwróconego wyniku.
+};
+
+/**
+ * Iterator po wynikach phfwdReverse().
+ */
+struct PhoneReverseIter {
+	char *text; ///< Kopia numeru, na którą wskazują klucz i sufiksy wyników.
+	struct Key key; ///< Numer, którego dotyczy wyszukiwanie.
+	struct RevMerge merge; ///< Stan scalania wyników.
+	char *buf; ///< Bufor na ostatnio zwrócony numer.
+	size_t cap; ///< Rozmiar bufora.
+	const char *word; ///< Słowo wyniku, którego nie udało się zwrócić.
+	const char *suffix; ///< Sufiks wyniku, którego nie udało się zwrócić.
+	/** Czy ostatnie wywołanie phfwdReverseIterNext() zawiodło. */
+	bool failed;
+	bool broken; ///< Czy scalanie przerwał błąd alokacji.
+};
+
+/**
+ * @brief Porównuje leksykograficznie konkatenacje dwóch par napisów.
+ *
+ * @param a1 Początek pierwszego napisu.
+ * @param a2 Koniec pierwszego napisu.
+ * @param b1 Początek drugiego napisu.
+ * @param b2 Koniec drugiego napisu.
+ *
+ * @return Liczba ujemna, zero lub dodatnia, tak jak dla strcmp().
+ */
+static int
+compareJoined(const char *a1, const char *a2, const char *b1, const char *b2)
+{
+	while (1) {
+		if (!*a1 && a2) {a1 = a2; a2 = NULL;}
+		if (!*b1 && b2) {b1 = b2; b2 = NULL;}
+		if (*a1 != *b1 || !*a1)
+			return (unsigned char)*a1 - (unsigned char)*b1;
+		++a1;
+		++b1;
+	}
+}
+
+/**
+ * @brief Sprawdza, czy bieżący wynik jednego ciągu poprzedza bieżący wynik
+ * drugiego.
+ *
+ * @param a Pierwszy ciąg.
+ * @param b Drugi ciąg.
+ */
+static inline bool
+runLess(const struct RevRun *a, const struct RevRun *b)
+{
+	return compareJoined(a->word, a->suffix, b->word, b->suffix) < 0;
+}
+
+/**
+ * @brief Przywraca własność kopca w dół od podanego miejsca.
+ *
+ * @param arg Stan scalania.
+ * @param idx Indeks ciągu, który mógł się zwiększyć.
+ */
+static void
+heapDown(struct RevMerge *arg, size_t idx)
+{
+	struct RevRun *h = arg->heap;
+	while (2 * idx + 1 < arg->size) {
+		size_t c = 2 * idx + 1;
+		if (c + 1 < arg->size && runLess(&h[c + 1], &h[c]))
+			++c;
+		if (!runLess(&h[c], &h[idx]))
+			break;
+		struct RevRun tmp = h[c];
+		h[c] = h[idx];
+		h[idx] = tmp;
+		idx = c;
+	}
+}
+
+/**
+ * @brief Dodaje ciąg do kopca.
+ *
+ * @param arg Stan scalania.
+ * @param run Dodawany ciąg z ustalonym bieżącym wynikiem.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+heapPush(struct RevMerge *arg, struct RevRun run)
+{
+	if (arg->size == arg->cap) {
+		size_t cap = arg->cap ? 2 * arg->cap : 8;
+		struct RevRun *new = realloc(arg->heap, cap * sizeof(struct RevRun));
+		if (!new) return false;
+		arg->heap = new;
+		arg->cap = cap;
+	}
+	size_t idx = arg->size++;
+	while (idx > 0 && runLess(&run, &arg->heap[(idx - 1) / 2])) {
+		arg->heap[idx] = arg->heap[(idx - 1) / 2];
+		idx = (idx - 1) / 2;
+	}
+	arg->heap[idx] = run;
+	return true;
+}
+
+/**
+ * @brief Przechodzi do następnego wyniku ciągu. Pomijane słowa, które są
+ * prefiksami swoich następników, trafiają do kopca jako osobne ciągi; ich
+ * wyniki nie poprzedzają bieżącego wyniku żadnego ciągu w kopcu.
+ *
+ * @param merge Stan scalania.
+ * @param[in,out] arg Ciąg, którego nie ma w kopcu.
+ *
+ * @return 1, jeśli ciąg ma nowy bieżący wynik, 0, jeśli się skończył, lub -1
+ * w przypadku błędu alokacji.
+ */
+static int
+runAdvance(struct RevMerge *merge, struct RevRun *arg)
+{
+	while (arg->next != arg->end) {
+		const char *word = (arg->next++)->word;
+		if (arg->next != arg->end) {
+			size_t len = strlen(word);
+			if (!strncmp(word, arg->next->word, len)) {
+				struct RevRun single = {word, arg->suffix, NULL, NULL};
+				if (!heapPush(merge, single)) return -1;
+				continue;
+			}
+		}
+		arg->word = word;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Zwalnia pamięć zajmowaną przez stan scalania.
+ *
+ * @param arg Stan scalania.
+ */
+static void
+revMergeFree(struct RevMerge *arg)
+{
+	free(arg->heap);
+}
+
+/**
+ * @brief Dodaje do scalania ciąg wyników dla jednego wierzchołka ścieżki,
+ * pomijając wyniki nie większe niż @p after.
+ * Słowo w daje wynik większy niż @p after wtedy, gdy jest większe od
+ * @p after i nie jest jego prefiksem, lub gdy @p after = w + a i sufiks jest
+ * większy niż a. Słowa pierwszego rodzaju tworzą sufiks wektora, a słów
+ * drugiego rodzaju jest co najwyżej tyle, ile znaków ma @p after.
+ *
+ * @param arg Stan scalania.
+ * @param vec Słowa przekierowane na wierzchołek.
+ * @param suffix Sufiks numeru za wierzchołkiem.
+ * @param after Napis lub NULL, jeśli nie należy pomijać żadnych wyników.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+revMergeAdd(struct RevMerge *arg, const struct Sources *vec,
+            const char *suffix, const char *after)
+{
+	size_t begin = 0;
+	if (after) {
+		size_t len = strlen(after);
+		begin = sourceLowerBound(vec, after, len);
+		if (begin < vec->count && !strcmp(vec->item[begin].word, after))
+			++begin;
+		for (size_t l = 1; l <= len; ++l) {
+			size_t idx = sourceLowerBound(vec, after, l);
+			if (idx == vec->count
+			    || compareN(vec->item[idx].word, after, l)
+			    || strcmp(suffix, after + l) <= 0)
+				continue;
+			struct RevRun single = {vec->item[idx].word, suffix, NULL, NULL};
+			if (!heapPush(arg, single)) return false;
+		}
+	}
+	struct RevRun run = {NULL, suffix, vec->item + begin,
+	                     vec->item + vec->count};
+	int res = runAdvance(arg, &run);
+	return res == 0 || (res > 0 && heapPush(arg, run));
+}
+
+/**
+ * @brief Przygotowuje scalanie wyników phfwdReverse() dla numeru.
+ *
+ * @param[out] arg Stan scalania. Po użyciu należy go zwolnić funkcją
+ * revMergeFree().
+ * @param to Korzeń drzewa "to".
+ * @param key Numer.
+ * @param after Napis lub NULL. Jeśli nie jest NULL, scalanie zwraca tylko
+ * wyniki leksykograficznie większe od niego.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+revMergeInit(struct RevMerge *arg, rt *to, const struct Key *key,
+             const char *after)
+{
+	*arg = (struct RevMerge){NULL, 0, 0, NULL, NULL};
+	if ((!after || strcmp(key->text, after) > 0)
+	    && !heapPush(arg, (struct RevRun){"", key->text, NULL, NULL}))
+		return false;
+	size_t pos = 0;
+	while (1) {
+		if (to->sources
+		    && !revMergeAdd(arg, to->sources, key->text + pos, after)) {
+			revMergeFree(arg);
+			return false;
+		}
+
+		if (pos == key->len) break;
+		rt *child = selectChild(to, digitAt(key->digits, pos));
+		if (!child || matchLabel(child, key, pos) < child->labelLength)
+			break;
+		pos += child->labelLength;
+		to = child;
+	}
+	return true;
+}
+
+/**
+ * @brief Wyznacza następny wynik phfwdReverse() w porządku leksykograficznym,
+ * pomijając powtórzenia.
+ *
+ * @param arg Stan scalania.
+ * @param[out] word Słowo wyniku.
+ * @param[out] suffix Sufiks wyniku. Wynikiem jest konkatenacja @p word
+ * i @p suffix.
+ *
+ * @return 1, jeśli wyznaczono wynik, 0, jeśli wyników już nie ma, lub -1
+ * w przypadku błędu alokacji.
+ */
+static int
+revMergeNext(struct RevMerge *arg, const char **word, const char **suffix)
+{
+	while (arg->size > 0) {
+		struct RevRun top = arg->heap[0];
+		struct RevRun run = top;
+		int res = runAdvance(arg, &run);
+		if (res < 0) return -1;
+		arg->heap[0] = res ? run : arg->heap[--arg->size];
+		heapDown(arg, 0);
+
+		if (arg->lastWord && !compareJoined(top.word, top.suffix,
+		                                    arg->lastWord, arg->lastSuffix))
+			continue;
+		arg->lastWord = *word = top.word;
+		arg->lastSuffix = *suffix = top.suffix;
+		return 1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Migawki
+//
+// Migawka pamięta tylko wersję struktury. Dopóki istnieje jakaś migawka,
+// każda zmiana przekierowania słowa jest zapisywana w historii wraz
+// z poprzednim przekierowaniem. Przekierowanie słowa w wersji v to więc
+// poprzednie przekierowanie z najstarszej zmiany nowszej niż v, a jeśli takiej
+// zmiany nie ma - bieżące przekierowanie z drzewa "from". Zmiany nie nowsze
+// niż najstarsza istniejąca migawka są usuwane z historii razem z nią.
+//
+// Migawki czytają bieżące drzewa i historię, które phfwdAdd()
+// i phfwdRemove() zmieniają w miejscu. Zapytania do migawek biorą więc
+// blokadę struktury do odczytu, a zmiany przekierowań - do zapisu. Zmiana
+// czeka na zakończenie trwających zapytań do migawek, ale nie na samo
+// istnienie migawek.
+
+/**
+ * @brief Zapisuje w historii przekierowania poddrzewa drzewa "from".
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param arg Korzeń poddrzewa.
+ * @param version Wersja, która powstanie po usunięciu poddrzewa.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+recordSubtree(struct PhoneForward *pf, const rt *arg, size_t version)
+{
+	if (arg->fwd && !historyRecord(&pf->history, arg->fullWord,
+	                               arg->fwd->fullWord, version))
+		return false;
+	for (unsigned i = 0; i < childCount(arg); ++i) {
+		if (!recordSubtree(pf, arg->children[i], version))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Zapisuje w historii przekierowania, które usunie removeBranch().
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param prefix Prefiks usuwanych słów.
+ * @param version Wersja, która powstanie po usunięciu.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+recordBranch(struct PhoneForward *pf, const struct Key *prefix, size_t version)
+{
+	const rt *root = getBranch(pf->from, prefix, 0);
+	return !root || recordSubtree(pf, root, version);
+}
+
+/**
+ * @brief Tworzy ciąg numerów z jednym numerem będącym konkatenacją dwóch
+ * napisów.
+ *
+ * @param prefix Pierwszy napis.
+ * @param suffix Drugi napis.
+ *
+ * @return Ciąg numerów lub NULL w przypadku błędu alokacji.
+ */
+static struct PhoneNumbers *
+joinNumber(const char *prefix, const char *suffix)
+{
+	size_t prefixLen = strlen(prefix);
+	size_t suffixLen = strlen(suffix);
+	size_t head = sizeof(struct PhoneNumbers) + sizeof(char*);
+	struct PhoneNumbers *new = malloc(head + prefixLen + suffixLen + 1);
+	if (!new) return NULL;
+	char *str = (char*)new + head;
+	memcpy(str, prefix, prefixLen);
+	memcpy(str + prefixLen, suffix, suffixLen + 1);
+	new->size = 1;
+	new->data[0] = str;
+	return new;
+}
+
+/**
+ * @brief Porównuje wyniki wyszukiwania odwrotnego według ich konkatenacji.
+ *
+ * @param a Pierwszy wynik.
+ * @param b Drugi wynik.
+ */
+static int
+pairOrder(const void *a, const void *b)
+{
+	const struct RevPair *x = a, *y = b;
+	return compareJoined(x->word, x->suffix, y->word, y->suffix);
+}
+
+/**
+ * @brief Dodaje wynik wyszukiwania odwrotnego do wektora.
+ *
+ * @param[in,out] vec Wektor.
+ * @param[in,out] size Liczba wyników w wektorze.
+ * @param[in,out] cap Pojemność wektora.
+ * @param pair Dodawany wynik.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+pushPair(struct RevPair **vec, size_t *size, size_t *cap, struct RevPair pair)
+{
+	if (*size == *cap) {
+		size_t newCap = *cap ? 2 * *cap : 16;
+		struct RevPair *new = realloc(*vec, newCap * sizeof(struct RevPair));
+		if (!new) return false;
+		*vec = new;
+		*cap = newCap;
+	}
+	(*vec)[(*size)++] = pair;
+	return true;
+}
+
+/**
+ * @brief Tworzy ciąg numerów z wyników wyszukiwania odwrotnego.
+ * Sortuje wyniki i pomija powtórzenia.
+ *
+ * @param vec Wyniki.
+ * @param size Liczba wyników.
+ *
+ * @return Ciąg numerów lub NULL w przypadku błędu alokacji.
+ */
+static struct PhoneNumbers *
+pairsToNumbers(struct RevPair *vec, size_t size)
+{
+	qsort(vec, size, sizeof(struct RevPair), pairOrder);
+	size_t count = 0, bytes = 0;
+	for (size_t i = 0; i < size; ++i) {
+		if (i > 0 && !pairOrder(&vec[i - 1], &vec[i])) continue;
+		++count;
+		bytes += strlen(vec[i].word) + strlen(vec[i].suffix) + 1;
+	}
+	size_t head = sizeof(struct PhoneNumbers) + count * sizeof(char*);
+	struct PhoneNumbers *new = malloc(head + bytes);
+	if (!new) return NULL;
+	char *out = (char*)new + head;
+	new->size = 0;
+	for (size_t i = 0; i < size; ++i) {
+		if (i > 0 && !pairOrder(&vec[i - 1], &vec[i])) continue;
+		size_t wordLen = strlen(vec[i].word);
+		size_t suffixLen = strlen(vec[i].suffix);
+		new->data[new->size++] = out;
+		memcpy(out, vec[i].word, wordLen);
+		memcpy(out + wordLen, vec[i].suffix, suffixLen + 1);
+		out += wordLen + suffixLen + 1;
+	}
+	return new;
+}
+
+/**
+ * @brief Zbiera wyniki phfwdReverse() dla migawki, nieposortowane
+ * i z możliwymi powtórzeniami.
+ *
+ * @param snap Migawka.
+ * @param key Numer.
+ * @param[out] vec Wektor wyników, który należy zwolnić funkcją free().
+ * @param[out] size Liczba wyników.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+snapshotPairs(const struct PhoneForwardSnapshot *snap, const struct Key *key,
+              struct RevPair **vec, size_t *size)
+{
+	const struct History *history = &snap->pf->history;
+	const char *old;
+	size_t cap = 0;
+	*vec = NULL;
+	*size = 0;
+	if (!pushPair(vec, size, &cap, (struct RevPair){"", key->text}))
+		return false;
+
+	/* Bieżące przekierowania słów, które nie zmieniły się od utworzenia
+	 * migawki. */
+	rt *arg = snap->pf->to;
+	size_t pos = 0;
+	while (1) {
+		const struct Sources *sources = arg->sources;
+		for (size_t i = 0; sources && i < sources->count; ++i) {
+			const char *word = sources->item[i].word;
+			if (historyFind(history, word, strlen(word), snap->version, &old))
+				continue;
+			if (!pushPair(vec, size, &cap,
+			              (struct RevPair){word, key->text + pos}))
+				return false;
+		}
+
+		if (pos == key->len) break;
+		rt *child = selectChild(arg, digitAt(key->digits, pos));
+		if (!child || matchLabel(child, key, pos) < child->labelLength)
+			break;
+		pos += child->labelLength;
+		arg = child;
+	}
+
+	/* Przekierowania z chwili utworzenia migawki słów, które później
+	 * się zmieniły. Takie słowo jest w indeksie celów historii pod swoim
+	 * ówczesnym przekierowaniem, więc wystarczy przejrzeć prefiksy numeru. */
+	for (size_t len = 1; len <= key->len; ++len) {
+		size_t count;
+		const struct TargetWord *words = historyTargets(history, key->text,
+		                                                len, &count);
+		for (size_t i = 0; i < count; ++i) {
+			const char *word = words[i].word;
+			if (words[i].version <= snap->version
+			    || !historyFind(history, word, strlen(word), snap->version,
+			                    &old)
+			    || !old || strlen(old) != len
+			    || memcmp(old, key->text, len))
+				continue;
+			if (!pushPair(vec, size, &cap,
+			              (struct RevPair){word, key->text + len}))
+				return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Zapytania wsadowe
+
+/**
+ * @brief Porównuje zapytania wsadowe leksykograficznie według numerów.
+ *
+ * @param a Pierwsze zapytanie.
+ * @param b Drugie zapytanie.
+ */
+static int
+queryOrder(const void *a, const void *b)
+{
+	return strcmp(((const struct BatchQuery*)a)->num,
+	              ((const struct BatchQuery*)b)->num);
+}
+
+/**
+ * @brief Zbiera poprawne numery z danych wejściowych zapytania wsadowego.
+ *
+ * @param nums Tablica numerów.
+ * @param n Długość tablicy @p nums.
+ * @param[out] count Liczba poprawnych numerów.
+ *
+ * @return Tablica zapytań dla poprawnych numerów w kolejności wejściowej
+ * lub NULL w przypadku błędu alokacji.
+ */
+static struct BatchQuery *
+makeQueries(char const *const *nums, size_t n, size_t *count)
+{
+	struct BatchQuery *ret = malloc((n ? n : 1) * sizeof(struct BatchQuery));
+	if (!ret) return NULL;
+	*count = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (!isNumber(nums[i]))
+			continue;
+		ret[(*count)++] = (struct BatchQuery){nums[i], strlen(nums[i]), i,
+		                                      "", 0};
+	}
+	return ret;
+}
+
+/**
+ * @brief Rozwiązuje posortowane zapytania jednym przejściem drzewa.
+ * Kolejne zapytania zaczynają schodzenie od najgłębszego wierzchołka ścieżki
+ * poprzedniego zapytania, którego słowo jest prefiksem obu numerów.
+ *
+ * @param root Korzeń drzewa przekierowań.
+ * @param[in,out] q Zapytania posortowane według numerów.
+ * @param count Liczba zapytań.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+resolveSorted(rt *root, struct BatchQuery *q, size_t count)
+{
+	size_t maxLen = 0;
+	for (size_t i = 0; i < count; ++i)
+		if (q[i].len > maxLen) maxLen = q[i].len;
+	struct PathStep *path = malloc((maxLen + 1) * sizeof(struct PathStep));
+	if (!path) return false;
+	path[0] = (struct PathStep){root, 0, "", 0};
+	if (root->fwd)
+		path[0].prefix = root->fwd->fullWord;
+
+	size_t depth = 0;
+	for (size_t i = 0; i < count; ++i) {
+		size_t common = 0;
+		if (i > 0) {
+			const char *prev = q[i - 1].num;
+			while (prev[common] && prev[common] == q[i].num[common])
+				++common;
+		}
+		while (path[depth].pos > common)
+			--depth;
+
+		struct Key k;
+		if (!makeKey(&k, q[i].num)) {free(path); return false;}
+		struct PathStep step = path[depth];
+		while (step.pos < k.len) {
+			rt *child = selectChild(step.node, digitAt(k.digits, step.pos));
+			if (!child || matchLabel(child, &k, step.pos) < child->labelLength)
+				break;
+			step.node = child;
+			step.pos += child->labelLength;
+			if (child->fwd) {
+				step.prefix = child->fwd->fullWord;
+				step.suffix = step.pos;
+			}
+			path[++depth] = step;
+		}
+		freeKey(&k);
+		q[i].prefix = step.prefix;
+		q[i].suffix = step.suffix;
+	}
+	free(path);
+	return true;
+}
+
+/**
+ * @brief Tworzy ciąg wyników zapytań wsadowych w jednym bloku pamięci.
+ *
+ * @param q Rozwiązane zapytania.
+ * @param count Liczba zapytań.
+ * @param n Liczba numerów w danych wejściowych.
+ *
+ * @return Ciąg długości @p n, w którym wyniki niepoprawnych numerów mają
+ * wartość NULL, lub NULL w przypadku błędu alokacji.
+ */
+static struct PhoneNumbers *
+packResults(const struct BatchQuery *q, size_t count, size_t n)
+{
+	size_t head = sizeof(struct PhoneNumbers) + n * sizeof(char*);
+	size_t total = head;
+	for (size_t i = 0; i < count; ++i)
+		total += strlen(q[i].prefix) + q[i].len - q[i].suffix + 1;
+	struct PhoneNumbers *ret = malloc(total);
+	if (!ret) return NULL;
+	ret->size = n;
+	for (size_t i = 0; i < n; ++i)
+		ret->data[i] = NULL;
+
+	char *out = (char*)ret + head;
+	for (size_t i = 0; i < count; ++i) {
+		size_t prefixLen = strlen(q[i].prefix);
+		size_t suffixLen = q[i].len - q[i].suffix;
+		ret->data[q[i].idx] = out;
+		memcpy(out, q[i].prefix, prefixLen);
+		memcpy(out + prefixLen, q[i].num + q[i].suffix, suffixLen);
+		out += prefixLen + suffixLen;
+		*out++ = '\0';
+	}
+	return ret;
+}
+
+/**
+ * @brief Sprowadza wierzchołek do pamięci podręcznej.
+ *
+ * @param arg Wierzchołek.
+ */
+static inline void
+prefetchNode(const rt *arg)
+{
+	__builtin_prefetch(arg);
+	__builtin_prefetch((const char*)arg + sizeof(rt) - 1);
+}
+
+/**
+ * @brief Rozpoczyna przeplatane wyszukiwanie.
+ *
+ * @param[out] arg Stan wyszukiwania.
+ * @param root Korzeń drzewa przekierowań.
+ * @param query Zapytanie.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+lookupStart(struct Lookup *arg, rt *root, struct BatchQuery *query)
+{
+	if (!makeKey(&arg->key, query->num)) return false;
+	arg->query = query;
+	arg->node = root;
+	arg->slot = NULL;
+	arg->pos = 0;
+	arg->best = NULL;
+	arg->suffix = 0;
+	return true;
+}
+
+/**
+ * @brief Wykonuje jeden krok przeplatanego wyszukiwania.
+ * Krok odczytuje tylko pamięć sprowadzoną przez poprzedni krok i zleca
+ * sprowadzenie pamięci potrzebnej w następnym, więc w czasie oczekiwania na
+ * nią mogą być wykonywane kroki innych wyszukiwań. Zejście o jeden poziom
+ * drzewa zajmuje dwa kroki: odczyt miejsca w tablicy dzieci i odwiedzenie
+ * wskazanego przez nie dziecka.
+ *
+ * @param arg Stan wyszukiwania.
+ *
+ * @return true, jeśli wyszukiwanie się zakończyło i jego wynik został
+ * zapisany w zapytaniu.
+ */
+static bool
+lookupStep(struct Lookup *arg)
+{
+	if (arg->slot) {
+		arg->node = *arg->slot;
+		arg->slot = NULL;
+		prefetchNode(arg->node);
+		return false;
+	}
+
+	rt *node = arg->node;
+	const struct Key *key = &arg->key;
+	bool done = matchLabel(node, key, arg->pos) < node->labelLength;
+	if (!done) {
+		arg->pos += node->labelLength;
+		if (node->fwd) {
+			arg->best = node->fwd;
+			arg->suffix = arg->pos;
+			__builtin_prefetch(&node->fwd->fullWord);
+		}
+		unsigned digit = arg->pos < key->len ? digitAt(key->digits, arg->pos)
+		                                     : DIGITS;
+		if (digit < DIGITS && node->childMask >> digit & 1) {
+			arg->slot = node->children + childIndex(node, digit);
+			__builtin_prefetch(arg->slot);
+			return false;
+		}
+	}
+	arg->query->prefix = arg->best ? arg->best->fullWord : "";
+	arg->query->suffix = arg->suffix;
+	freeKey(&arg->key);
+	return true;
+}
+
+/**
+ * @brief Rozwiązuje zapytania, przeplatając do LOOKUP_GROUP wyszukiwań naraz.
+ *
+ * @param root Korzeń drzewa przekierowań.
+ * @param[in,out] q Zapytania.
+ * @param count Liczba zapytań.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+resolveInterleaved(rt *root, struct BatchQuery *q, size_t count)
+{
+	/* Klucze wskazują na własne bufory, więc stany nie są przenoszone,
+	 * a jedynie wskaźniki na nie. */
+	struct Lookup group[LOOKUP_GROUP];
+	struct Lookup *live[LOOKUP_GROUP];
+	size_t active = 0;
+	size_t next = 0;
+	bool ok = true;
+	while (ok && active < LOOKUP_GROUP && next < count) {
+		live[active] = &group[active];
+		ok = lookupStart(live[active], root, &q[next++]);
+		if (ok) ++active;
+	}
+
+	while (active > 0) {
+		for (size_t i = 0; i < active; ) {
+			if (!lookupStep(live[i])) {
+				++i;
+				continue;
+			}
+			if (ok && next < count) {
+				ok = lookupStart(live[i], root, &q[next++]);
+				if (ok) continue;
+			}
+			live[i] = live[--active];
+		}
+	}
+	return ok;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Ładowanie wsadowe
+//
+// phfwdAddBulk() buduje oba drzewa pustej struktury od dołu z posortowanych
+// słów. Kolejne słowo różni się od poprzedniego dopiero za ich najdłuższym
+// wspólnym prefiksem, więc na stosie wystarczy trzymać ścieżkę do ostatnio
+// dodanego słowa. Wierzchołek zdjęty ze stosu ma już wszystkie dzieci, więc
+// jego etykieta i tablica dzieci są alokowane raz, w ostatecznym rozmiarze.
+//
+// Jeśli struktura ma pulę wątków, słowa zaczynające się różnymi cyframi trafiają
+// do rozłącznych poddrzew korzeni, więc każde z nich jest budowane przez osobne
+// zadanie z własnym alokatorem, a na końcu podwieszane pod korzeń.
+
+/**
+ * Słowo ładowane do drzewa.
+ */
+struct BulkKey {
+	const char *text; ///< Słowo.
+	size_t len; ///< Długość słowa.
+	rt *node; ///< Wierzchołek słowa po zbudowaniu drzewa.
+};
+
+/**
+ * Przekierowanie ładowane przez phfwdAddBulk().
+ */
+struct BulkRule {
+	struct BulkKey from; ///< Słowo przekierowywane.
+	struct BulkKey to; ///< Słowo, na które jest przekierowanie.
+};
+
+/**
+ * Przekierowanie wraz z kluczem sortowania.
+ */
+struct BulkItem {
+	uint64_t key; ///< Klucz wyznaczony przez bulkKey().
+	struct BulkRule *rule; ///< Przekierowanie.
+};
+
+/**
+ * Wierzchołek na stosie budowanego drzewa.
+ */
+struct BulkEntry {
+	rt *node; ///< Wierzchołek.
+	size_t depth; ///< Długość słowa odpowiadającego wierzchołkowi.
+	const char *text; ///< Słowo, którego prefiksem jest słowo wierzchołka.
+	/** Początek dzieci wierzchołka na liście oczekujących. */
+	size_t childStart;
+};
+
+/**
+ * @brief Zwraca słowo przekierowania, według którego są sortowane.
+ *
+ * @param arg Przekierowanie.
+ * @param target Czy chodzi o słowo, na które jest przekierowanie.
+ */
+static inline const char *
+ruleKey(const struct BulkRule *arg, bool target)
+{
+	return target ? arg->to.text : arg->from.text;
+}
+
+/**
+ * @brief Sortuje stabilnie przekierowania o wspólnym prefiksie słów.
+ * Rozdziela je kubełkowo według cyfry na pozycji @p depth (słowa kończące się
+ * przed nią trafiają na początek) i rekurencyjnie sortuje kubełki. Krótkie
+ * fragmenty sortuje przez wstawianie.
+ *
+ * @param arr Sortowane przekierowania.
+ * @param tmp Bufor pomocniczy na @p n elementów.
+ * @param n Liczba przekierowań.
+ * @param depth Długość wspólnego prefiksu słów.
+ * @param target Czy sortować według słowa, na które jest przekierowanie,
+ * czy według słowa przekierowywanego.
+ */
+static void
+sortRulesTail(struct BulkRule **arr, struct BulkRule **tmp, size_t n,
+              size_t depth, bool target)
+{
+	if (n < BULK_INSERTION_SORT) {
+		for (size_t i = 1; i < n; ++i) {
+			struct BulkRule *cur = arr[i];
+			const char *key = ruleKey(cur, target) + depth;
+			size_t j = i;
+			while (j > 0) {
+				const char *prev = ruleKey(arr[j - 1], target);
+				if (strcmp(prev + depth, key) <= 0)
+					break;
+				arr[j] = arr[j - 1];
+				--j;
+			}
+			arr[j] = cur;
+		}
+		return;
+	}
+
+	size_t start[DIGITS + 2] = {0};
+	for (size_t i = 0; i < n; ++i) {
+		char c = ruleKey(arr[i], target)[depth];
+		++start[c ? c - '0' + 2 : 1];
+	}
+	for (unsigned c = 1; c < DIGITS + 2; ++c)
+		start[c] += start[c - 1];
+	size_t pos[DIGITS + 1];
+	memcpy(pos, start, sizeof(pos));
+	for (size_t i = 0; i < n; ++i) {
+		char c = ruleKey(arr[i], target)[depth];
+		tmp[pos[c ? c - '0' + 1 : 0]++] = arr[i];
+	}
+	memcpy(arr, tmp, n * sizeof(struct BulkRule*));
+	for (unsigned c = 1; c <= DIGITS; ++c) {
+		size_t size = start[c + 1] - start[c];
+		sortRulesTail(arr + start[c], tmp + start[c], size, depth + 1,
+		              target);
+	}
+}
+
+/**
+ * @brief Wyznacza klucz sortowania słowa: jego pierwsze BULK_KEY_DIGITS cyfr
+ * zapisane od najstarszych bitów po cztery bity jako cyfra + 1. Koniec słowa
+ * jest zapisywany jako zera, więc porządek kluczy zgadza się z porządkiem
+ * leksykograficznym prefiksów.
+ *
+ * @param text Słowo.
+ */
+static inline uint64_t
+bulkKey(const char *text)
+{
+	uint64_t ret = 0;
+	for (unsigned i = 0; i < BULK_KEY_DIGITS && text[i]; ++i)
+		ret |= (uint64_t)(text[i] - '0' + 1) << (60 - 4 * i);
+	return ret;
+}
+
+/**
+ * @brief Sortuje stabilnie przekierowania według słów.
+ * Sortuje pozycyjnie po bajtach klucze bulkKey() leżące w ciągłej tablicy,
+ * a przekierowania o równych kluczach i dłuższych słowach porządkuje
+ * funkcją sortRulesTail().
+ *
+ * @param arr Sortowane przekierowania.
+ * @param n Liczba przekierowań.
+ * @param target Czy sortować według słowa, na które jest przekierowanie,
+ * czy według słowa przekierowywanego.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+sortRules(struct BulkRule **arr, size_t n, bool target)
+{
+	struct BulkItem *items = malloc((n ? n : 1) * sizeof(struct BulkItem));
+	struct BulkItem *tmp = malloc((n ? n : 1) * sizeof(struct BulkItem));
+	if (!items || !tmp) {
+		free(items);
+		free(tmp);
+		return false;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		uint64_t key = bulkKey(ruleKey(arr[i], target));
+		items[i] = (struct BulkItem){key, arr[i]};
+	}
+
+	for (unsigned shift = 0; shift < 64; shift += 8) {
+		size_t start[257] = {0};
+		for (size_t i = 0; i < n; ++i)
+			++start[(items[i].key >> shift & 0xFF) + 1];
+		if (n && start[(items[0].key >> shift & 0xFF) + 1] == n)
+			continue;
+		for (unsigned b = 1; b < 257; ++b)
+			start[b] += start[b - 1];
+		for (size_t i = 0; i < n; ++i)
+			tmp[start[items[i].key >> shift & 0xFF]++] = items[i];
+		struct BulkItem *swap = items;
+		items = tmp;
+		tmp = swap;
+	}
+
+	for (size_t i = 0; i < n; ++i)
+		arr[i] = items[i].rule;
+	struct BulkRule **aux = (struct BulkRule **)tmp;
+	for (size_t i = 0, end; i < n; i = end) {
+		uint64_t key = items[i].key;
+		for (end = i + 1; end < n && items[end].key == key; ++end) ;
+		if (end - i > 1 && (key & 0xF)) {
+			sortRulesTail(arr + i, aux, end - i, BULK_KEY_DIGITS,
+			              target);
+		}
+	}
+	free(items);
+	free(tmp);
+	return true;
+}
+
+/**
+ * @brief Ustawia etykietę nowego wierzchołka na fragment słowa.
+ *
+ * @param mem Alokator drzewa.
+ * @param arg Wierzchołek bez etykiety.
+ * @param text Początek etykiety w słowie.
+ * @param len Długość etykiety.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+setLabelText(struct Arena *mem, rt *arg, const char *text, size_t len)
+{
+	if (len > LABEL_INLINE) {
+		arg->label.ptr = arenaAlloc(mem, digitsSize(len));
+		if (!arg->label.ptr) return false;
+	}
+	arg->labelLength = len;
+	digitsPack((uint8_t*)labelOf(arg), text, len);
+	arg->charset = digitsCharset(labelOf(arg), 0, len);
+	return true;
+}
+
+/**
+ * @brief Kończy budowę wierzchołka zdjętego ze stosu: ustawia jego etykietę
+ * i tablicę dzieci, po czym dopisuje go do listy oczekujących jako dziecko
+ * wierzchołka pod nim.
+ *
+ * @param mem Alokator drzewa.
+ * @param arg Wierzchołek.
+ * @param parentDepth Długość słowa rodzica; 0 dla korzenia.
+ * @param pending Lista oczekujących wierzchołków.
+ * @param[in,out] pendingLen Długość listy oczekujących.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+finishEntry(struct Arena *mem, const struct BulkEntry *arg, size_t parentDepth,
+            rt **pending, size_t *pendingLen)
+{
+	rt *node = arg->node;
+	if (arg->depth > parentDepth
+	    && !setLabelText(mem, node, arg->text + parentDepth,
+	                     arg->depth - parentDepth))
+		return false;
+	unsigned count = *pendingLen - arg->childStart;
+	if (count) {
+		node->childCap = childCapFor(count);
+		node->children = arenaAlloc(mem, node->childCap * sizeof(rt*));
+		if (!node->children) return false;
+		for (unsigned i = 0; i < count; ++i) {
+			rt *child = pending[arg->childStart + i];
+			child->parent = node;
+			node->childMask |= 1u << firstDigit(child);
+			node->children[i] = child;
+		}
+	}
+	*pendingLen = arg->childStart;
+	pending[(*pendingLen)++] = node;
+	return true;
+}
+
+/**
+ * @brief Buduje drzewo z posortowanych, różnych słów.
+ *
+ * @param mem Alokator drzewa.
+ * @param root Korzeń pustego drzewa.
+ * @param keys Słowa posortowane leksykograficznie. Funkcja ustawia ich
+ * wierzchołki.
+ * @param count Liczba słów.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+buildTree(struct Arena *mem, rt *root, struct BulkKey *const *keys,
+          size_t count)
+{
+	struct BulkEntry *stack = malloc((2 * count + 1)
+	                                 * sizeof(struct BulkEntry));
+	rt **pending = malloc((2 * count + 1) * sizeof(rt*));
+	bool ret = stack && pending;
+	size_t top = 0, pendingLen = 0;
+	if (ret)
+		stack[top++] = (struct BulkEntry){root, 0, "", 0};
+	for (size_t i = 0; ret && i < count; ++i) {
+		size_t common = 0;
+		if (i > 0) {
+			const char *prev = keys[i - 1]->text;
+			const char *text = keys[i]->text;
+			while (prev[common] && prev[common] == text[common])
+				++common;
+		}
+		while (ret && stack[top - 1].depth > common) {
+			struct BulkEntry entry = stack[--top];
+			if (stack[top - 1].depth < common) {
+				rt *split = makeRT(mem);
+				if (!split) {ret = false; break;}
+				struct BulkEntry up = entry;
+				up.node = split;
+				up.depth = common;
+				stack[top++] = up;
+			}
+			ret = finishEntry(mem, &entry, stack[top - 1].depth,
+			                  pending, &pendingLen);
+		}
+		rt *node = ret ? makeRT(mem) : NULL;
+		if (!node) {ret = false; break;}
+		stack[top++] = (struct BulkEntry){
+			node, keys[i]->len, keys[i]->text, pendingLen};
+		keys[i]->node = node;
+	}
+	while (ret && top > 1) {
+		struct BulkEntry entry = stack[--top];
+		ret = finishEntry(mem, &entry, stack[top - 1].depth,
+		                  pending, &pendingLen);
+	}
+	if (ret)
+		ret = finishEntry(mem, &stack[0], 0, pending, &pendingLen);
+	free(stack);
+	free(pending);
+	return ret;
+}
+
+/**
+ * @brief Ustawia liczniki słów, na które istnieją przekierowania, w poddrzewie
+ * drzewa "to". Tak jak addAsRev() rezerwuje licznik dla każdego takiego słowa,
+ * ale zwiększa tylko liczniki słów minimalnych.
+ *
+ * @param arg Liczniki.
+ * @param node Wierzchołek.
+ * @param depth Długość słowa odpowiadającego @p node.
+ * @param mask Zakodowany przez charset() zbiór cyfr tego słowa.
+ * @param covered Czy na jakiś właściwy prefiks tego słowa istnieją
+ * przekierowania.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+countBulk(struct CountIndex *arg, const rt *node, size_t depth, unsigned mask,
+          bool covered)
+{
+	if (node->sources) {
+		if (!countReserve(arg, depth, mask))
+			return false;
+		if (!covered)
+			++*countFind(arg, depth, mask);
+		covered = true;
+	}
+	for (unsigned i = 0; i < childCount(node); ++i) {
+		const rt *child = node->children[i];
+		if (!countBulk(arg, child, depth + child->labelLength,
+		               mask | child->charset, covered))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Łączy zbudowane drzewa przekierowaniami.
+ *
+ * @param mem Alokator drzew.
+ * @param byTarget Przekierowania posortowane funkcją targetOrder(),
+ * z ustalonymi wierzchołkami.
+ * @param count Liczba przekierowań.
+ * @param[out] targets Liczba różnych słów, na które są przekierowania.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+linkBulk(struct Arena *mem, struct BulkRule *const *byTarget, size_t count,
+         size_t *targets)
+{
+	*targets = 0;
+	for (size_t i = 0, end; i < count; i = end) {
+		rt *to = byTarget[i]->to.node;
+		end = i;
+		while (end < count && byTarget[end]->to.node == to)
+			++end;
+		struct Sources *vec = arenaAlloc(mem, sourcesSize(end - i));
+		to->fullWord = arenaCopy(mem, byTarget[i]->to.text, NULL);
+		to->sources = vec;
+		if (!to->fullWord || !vec) return false;
+		vec->count = vec->cap = end - i;
+		vec->bytes = 0;
+		for (size_t j = i; j < end; ++j) {
+			const struct BulkKey *src = &byTarget[j]->from;
+			rt *from = src->node;
+			from->fullWord = arenaCopy(mem, src->text, NULL);
+			if (!from->fullWord) return false;
+			from->fwd = to;
+			vec->item[j - i].word = from->fullWord;
+			vec->item[j - i].node = from;
+			vec->bytes += src->len;
+		}
+		++*targets;
+	}
+	return true;
+}
+
+/**
+ * @brief Ładuje przekierowania do pustej struktury.
+ *
+ * @param pf Struktura bez przekierowań i migawek.
+ * @param rules Poprawne przekierowania.
+ * @param count Liczba przekierowań.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ * W przypadku błędu struktura się nie zmienia.
+ */
+static bool
+loadBulk(struct PhoneForward *pf, struct BulkRule *rules, size_t count)
+{
+	size_t size = count ? count : 1;
+	struct BulkRule **order = malloc(size * sizeof(struct BulkRule*));
+	struct BulkRule **byTarget = malloc(size * sizeof(struct BulkRule*));
+	struct BulkKey **keys = malloc(size * sizeof(struct BulkKey*));
+	if (!order || !byTarget || !keys) {
+		free(order);
+		free(byTarget);
+		free(keys);
+		return false;
+	}
+
+	/* Sortowanie jest stabilne, więc z powtórzeń słowa przekierowywanego
+	 * ostatnie pochodzi z ostatniej pary o tym słowie. */
+	for (size_t i = 0; i < count; ++i)
+		order[i] = &rules[i];
+	if (!sortRules(order, count, false)) {
+		free(order);
+		free(byTarget);
+		free(keys);
+		return false;
+	}
+	size_t unique = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (i + 1 < count
+		    && !strcmp(order[i]->from.text, order[i + 1]->from.text))
+			continue;
+		order[unique++] = order[i];
+	}
+
+	struct Arena mem;
+	arenaInit(&mem);
+	rt *from = makeRT(&mem);
+	rt *to = makeRT(&mem);
+	bool ret = from && to;
+	size_t targets = 0;
+	if (ret) {
+		for (size_t i = 0; i < unique; ++i)
+			keys[i] = &order[i]->from;
+		ret = buildTree(&mem, from, keys, unique);
+	}
+	if (ret) {
+		/* Przekierowania są już posortowane według słów
+		 * przekierowywanych, więc po stabilnym sortowaniu według słów
+		 * docelowych każdy wektor źródeł jest od razu posortowany. */
+		memcpy(byTarget, order, unique * sizeof(struct BulkRule*));
+		ret = sortRules(byTarget, unique, true);
+	}
+	if (ret) {
+		size_t distinct = 0;
+		for (size_t i = 0; i < unique; ++i) {
+			const char *text = byTarget[i]->to.text;
+			if (!i || strcmp(byTarget[i - 1]->to.text, text))
+				keys[distinct++] = &byTarget[i]->to;
+		}
+		ret = buildTree(&mem, to, keys, distinct);
+		for (size_t i = 1; ret && i < unique; ++i) {
+			if (!byTarget[i]->to.node)
+				byTarget[i]->to.node = byTarget[i - 1]->to.node;
+		}
+	}
+	ret = ret && linkBulk(&mem, byTarget, unique, &targets);
+	if (ret) {
+		countIndexFree(&pf->counts);
+		ret = countBulk(&pf->counts, to, 0, 0, false);
+		if (!ret)
+			countIndexFree(&pf->counts);
+	}
+	free(order);
+	free(byTarget);
+	free(keys);
+	if (!ret) {
+		arenaClear(&mem);
+		return false;
+	}
+	arenaClear(&pf->mem);
+	pf->mem = mem;
+	pf->from = from;
+	pf->to = to;
+	pf->targets = targets;
+	++pf->version;
+	return true;
+}
+
+/**
+ * Przekierowania ładowane równolegle, których słowa (przekierowywane albo
+ * docelowe, zależnie od etapu) zaczynają się tą samą cyfrą. Każda część jest
+ * przetwarzana przez jedno zadanie, które alokuje wierzchołki z własnego
+ * alokatora.
+ */
+struct BulkPart {
+	struct Arena mem; ///< Alokator części.
+	struct BulkRule **rules; ///< Przekierowania części.
+	struct BulkKey **keys; ///< Bufor na słowa części.
+	size_t count; ///< Liczba przekierowań części.
+	rt *from; ///< Korzeń drzewa "from" zbudowanego z części lub NULL.
+	rt *to; ///< Korzeń drzewa "to" zbudowanego z części lub NULL.
+	size_t targets; ///< Liczba różnych słów, na które są przekierowania.
+	struct CountIndex counts; ///< Liczniki słów z drzewa "to" części.
+	bool ok; ///< Czy nie wystąpił błąd alokacji.
+};
+
+/**
+ * Etap równoległego ładowania przekierowań.
+ */
+struct BulkJob {
+	struct BulkPart parts[DIGITS]; ///< Części.
+	bool target; ///< Czy części są wyznaczone przez słowa docelowe.
+};
+
+/**
+ * @brief Rozdziela stabilnie przekierowania na części według pierwszej cyfry
+ * słowa.
+ *
+ * @param dst Tablica, do której trafiają kolejne części.
+ * @param src Rozdzielane przekierowania.
+ * @param count Liczba przekierowań.
+ * @param target Czy rozdzielać według słowa, na które jest przekierowanie,
+ * czy według słowa przekierowywanego.
+ * @param keys Bufor na słowa o rozmiarze @p count, dzielony między części.
+ * @param parts Części, którym funkcja ustawia przekierowania i bufory.
+ */
+static void
+partitionRules(struct BulkRule **dst, struct BulkRule *const *src,
+               size_t count, bool target, struct BulkKey **keys,
+               struct BulkPart *parts)
+{
+	size_t start[DIGITS + 1] = {0};
+	for (size_t i = 0; i < count; ++i)
+		++start[ruleKey(src[i], target)[0] - '0' + 1];
+	for (unsigned d = 0; d < DIGITS; ++d) {
+		start[d + 1] += start[d];
+		parts[d].rules = dst + start[d];
+		parts[d].keys = keys + start[d];
+		parts[d].count = start[d + 1] - start[d];
+	}
+	for (size_t i = 0; i < count; ++i)
+		dst[start[ruleKey(src[i], target)[0] - '0']++] = src[i];
+}
+
+/**
+ * @brief Buduje drzewo "from" z części przekierowań. Usuwa z części
+ * powtórzenia słów przekierowywanych, zostawiając ostatnie.
+ *
+ * @param arg Część.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+buildFromPart(struct BulkPart *arg)
+{
+	if (!sortRules(arg->rules, arg->count, false))
+		return false;
+	size_t unique = 0;
+	for (size_t i = 0; i < arg->count; ++i) {
+		if (i + 1 < arg->count
+		    && !strcmp(arg->rules[i]->from.text, arg->rules[i + 1]->from.text))
+			continue;
+		arg->rules[unique++] = arg->rules[i];
+	}
+	arg->count = unique;
+	for (size_t i = 0; i < unique; ++i)
+		arg->keys[i] = &arg->rules[i]->from;
+	arg->from = makeRT(&arg->mem);
+	return arg->from && buildTree(&arg->mem, arg->from, arg->keys, unique);
+}
+
+/**
+ * @brief Buduje drzewo "to" z części przekierowań, łączy je z wierzchołkami
+ * drzewa "from" i wyznacza liczniki części.
+ *
+ * @param arg Część, której przekierowania są posortowane według słów
+ * przekierowywanych.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+buildToPart(struct BulkPart *arg)
+{
+	if (!sortRules(arg->rules, arg->count, true))
+		return false;
+	size_t distinct = 0;
+	for (size_t i = 0; i < arg->count; ++i) {
+		if (!i || strcmp(arg->rules[i - 1]->to.text, arg->rules[i]->to.text))
+			arg->keys[distinct++] = &arg->rules[i]->to;
+	}
+	arg->to = makeRT(&arg->mem);
+	if (!arg->to || !buildTree(&arg->mem, arg->to, arg->keys, distinct))
+		return false;
+	for (size_t i = 1; i < arg->count; ++i) {
+		if (!arg->rules[i]->to.node)
+			arg->rules[i]->to.node = arg->rules[i - 1]->to.node;
+	}
+	return linkBulk(&arg->mem, arg->rules, arg->count, &arg->targets)
+	       && countBulk(&arg->counts, arg->to, 0, 0, false);
+}
+
+/**
+ * @brief Wykonuje etap ładowania przekierowań dla jednej części.
+ *
+ * @param ctx Etap (struct BulkJob).
+ * @param idx Indeks części.
+ */
+static void
+bulkTask(void *ctx, size_t idx)
+{
+	struct BulkJob *job = ctx;
+	struct BulkPart *part = &job->parts[idx];
+	if (part->count)
+		part->ok = job->target ? buildToPart(part) : buildFromPart(part);
+}
+
+/**
+ * @brief Dodaje do liczników wartości innych liczników.
+ *
+ * @param dst Liczniki docelowe.
+ * @param src Dodawane liczniki.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+countMerge(struct CountIndex *dst, const struct CountIndex *src)
+{
+	for (size_t d = 0; d < src->depth; ++d) {
+		const struct CountLevel *level = &src->levels[d];
+		for (size_t i = 0; i < level->size; ++i) {
+			const struct CountTerm *term = &level->terms[i];
+			if (!countReserve(dst, d, term->mask))
+				return false;
+			*countFind(dst, d, term->mask) += term->count;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Podwiesza pod korzeń drzewa poddrzewa zbudowane z części.
+ * Korzeń poddrzewa części ma co najwyżej jedno dziecko, bo wszystkie słowa
+ * części zaczynają się tą samą cyfrą.
+ *
+ * @param mem Alokator drzewa, do którego przeniesiono pamięć części.
+ * @param root Korzeń pustego drzewa.
+ * @param roots Korzenie poddrzew kolejnych części lub NULL. Funkcja je zwalnia.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+stitchParts(struct Arena *mem, rt *root, rt *const *roots)
+{
+	unsigned count = 0;
+	for (unsigned d = 0; d < DIGITS; ++d)
+		count += roots[d] && childCount(roots[d]);
+	if (count) {
+		root->childCap = childCapFor(count);
+		root->children = arenaAlloc(mem, root->childCap * sizeof(rt*));
+		if (!root->children) return false;
+	}
+	count = 0;
+	for (unsigned d = 0; d < DIGITS; ++d) {
+		rt *sub = roots[d];
+		if (!sub) continue;
+		if (childCount(sub)) {
+			rt *child = sub->children[0];
+			child->parent = root;
+			root->childMask |= 1u << firstDigit(child);
+			root->children[count++] = child;
+			arenaFree(mem, sub->children, sub->childCap * sizeof(rt*));
+		}
+		arenaFree(mem, sub, sizeof(rt));
+	}
+	return true;
+}
+
+/**
+ * @brief Ładuje przekierowania do pustej struktury, dzieląc pracę między
+ * wątki jej puli.
+ * Przekierowania są rozdzielane według pierwszej cyfry słowa
+ * przekierowywanego i z każdej części osobno powstaje poddrzewo drzewa
+ * "from". Następnie są rozdzielane według pierwszej cyfry słowa docelowego
+ * i z każdej części powstaje poddrzewo drzewa "to" wraz z wektorami źródeł
+ * i licznikami. Na końcu poddrzewa są podwieszane pod korzenie, a liczniki
+ * sumowane.
+ *
+ * @param pf Struktura bez przekierowań i migawek, z pulą wątków.
+ * @param rules Poprawne przekierowania.
+ * @param count Liczba przekierowań.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ * W przypadku błędu struktura się nie zmienia.
+ */
+static bool
+loadBulkParallel(struct PhoneForward *pf, struct BulkRule *rules,
+                 size_t count)
+{
+	struct BulkRule **order = malloc(count * sizeof(struct BulkRule*));
+	struct BulkRule **byTarget = malloc(count * sizeof(struct BulkRule*));
+	struct BulkKey **keys = calloc(count, sizeof(struct BulkKey*));
+	struct BulkJob *job = malloc(sizeof(struct BulkJob));
+	bool ret = order && byTarget && keys && job;
+	for (unsigned d = 0; job && d < DIGITS; ++d) {
+		struct BulkPart *part = &job->parts[d];
+		arenaInit(&part->mem);
+		part->from = part->to = NULL;
+		part->targets = 0;
+		part->counts = (struct CountIndex){NULL, 0};
+		part->ok = true;
+	}
+	if (ret) {
+		for (size_t i = 0; i < count; ++i)
+			byTarget[i] = &rules[i];
+		partitionRules(order, byTarget, count, false, keys, job->parts);
+		job->target = false;
+		poolRun(pf->pool, bulkTask, job, DIGITS);
+		for (unsigned d = 0; d < DIGITS; ++d)
+			ret &= job->parts[d].ok;
+	}
+	if (ret) {
+		/* Części są posortowane według słów przekierowywanych i następują po
+		 * sobie w kolejności cyfr, więc ich złączenie jest posortowane,
+		 * a po stabilnym rozdzieleniu i sortowaniu według słów docelowych
+		 * każdy wektor źródeł jest od razu posortowany. */
+		size_t unique = 0;
+		for (unsigned d = 0; d < DIGITS; ++d) {
+			struct BulkPart *part = &job->parts[d];
+			memmove(order + unique, part->rules,
+			        part->count * sizeof(struct BulkRule*));
+			unique += part->count;
+		}
+		partitionRules(byTarget, order, unique, true, keys, job->parts);
+		job->target = true;
+		poolRun(pf->pool, bulkTask, job, DIGITS);
+		for (unsigned d = 0; d < DIGITS; ++d)
+			ret &= job->parts[d].ok;
+	}
+
+	struct Arena mem;
+	arenaInit(&mem);
+	struct CountIndex counts = {NULL, 0};
+	size_t targets = 0;
+	rt *from = NULL, *to = NULL;
+	if (ret) {
+		rt *fromRoots[DIGITS], *toRoots[DIGITS];
+		for (unsigned d = 0; d < DIGITS; ++d) {
+			struct BulkPart *part = &job->parts[d];
+			arenaMerge(&mem, &part->mem);
+			fromRoots[d] = part->from;
+			toRoots[d] = part->to;
+			targets += part->targets;
+			ret = ret && countMerge(&counts, &part->counts);
+		}
+		from = makeRT(&mem);
+		to = makeRT(&mem);
+		ret = ret && from && to && stitchParts(&mem, from, fromRoots)
+		      && stitchParts(&mem, to, toRoots);
+	}
+	if (job) {
+		for (unsigned d = 0; d < DIGITS; ++d) {
+			arenaClear(&job->parts[d].mem);
+			countIndexFree(&job->parts[d].counts);
+		}
+	}
+	free(order);
+	free(byTarget);
+	free(keys);
+	free(job);
+	if (!ret) {
+		arenaClear(&mem);
+		countIndexFree(&counts);
+		return false;
+	}
+	arenaClear(&pf->mem);
+	countIndexFree(&pf->counts);
+	pf->mem = mem;
+	pf->counts = counts;
+	pf->from = from;
+	pf->to = to;
+	pf->targets = targets;
+	++pf->version;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Zapis i odczyt
+//
+// Plik zaczyna się nagłówkiem SaveHeader. Po nim leżą rekordy SaveNode
+// wierzchołków drzewa "from", a potem drzewa "to", oba w porządku preorder,
+// następnie przekierowania jako pary indeksów wierzchołków (SaveLink),
+// posortowane według indeksów w drzewie "from", a na końcu upakowane etykiety
+// wszystkich wierzchołków w tej samej kolejności co rekordy. Liczby są
+// zapisane w kolejności bajtów komputera zapisującego. Poddrzewa bez słów,
+// które mogą zostać w drzewie "from" po phfwdRemove(), nie są zapisywane.
+//
+// Porządek preorder drzewa "from" jest porządkiem leksykograficznym słów,
+// więc phfwdLoad() wypełnia wektory źródeł od razu posortowane. Pełne słowa
+// odtwarza z etykiet na ścieżce, a liczniki tak jak phfwdAddBulk().
+
+/**
+ * Nagłówek pliku z zapisaną strukturą.
+ */
+struct SaveHeader {
+	char magic[4]; ///< SAVE_MAGIC.
+	uint32_t version; ///< SAVE_VERSION.
+	uint32_t byteOrder; ///< SAVE_BYTE_ORDER.
+	uint32_t reserved; ///< Zero.
+	uint64_t nodes[2]; ///< Liczba wierzchołków drzew "from" i "to".
+	uint64_t links; ///< Liczba przekierowań.
+	uint64_t labelBytes; ///< Łączny rozmiar upakowanych etykiet.
+};
+
+/**
+ * Zapisany wierzchołek drzewa.
+ */
+struct SaveNode {
+	uint32_t labelLength; ///< Długość etykiety.
+	uint16_t childMask; ///< Zbiór pierwszych cyfr etykiet dzieci.
+	uint16_t reserved; ///< Zero.
+};
+
+/**
+ * Zapisane przekierowanie.
+ */
+struct SaveLink {
+	uint32_t from; ///< Indeks wierzchołka w drzewie "from".
+	uint32_t to; ///< Indeks wierzchołka w drzewie "to".
+};
+
+/**
+ * Indeks wierzchołka drzewa "to" w porządku preorder, element tablicy
+ * z haszowaniem otwartym, której kluczami są adresy wierzchołków.
+ */
+struct NodeIndex {
+	const rt *node; ///< Wierzchołek.
+	uint32_t idx; ///< Indeks.
+};
+
+/**
+ * Miejsca w buforze, do których saveTree() zapisuje kolejne dane.
+ */
+struct SaveCursor {
+	struct SaveNode *nodes; ///< Następny rekord wierzchołka.
+	uint8_t *labels; ///< Następna etykieta.
+	struct SaveLink *links; ///< Następne przekierowanie.
+	const size_t *skip; ///< Wynik markTree() dla następnego wierzchołka.
+	struct NodeIndex *targets; ///< Indeksy wierzchołków drzewa "to".
+	size_t mask; ///< Rozmiar tablicy @p targets pomniejszony o 1.
+	uint32_t next; ///< Indeks następnego zapisanego wierzchołka.
+};
+
+/**
+ * @brief Wyszukuje miejsce wierzchołka w tablicy indeksów.
+ *
+ * @param table Tablica indeksów o rozmiarze będącym potęgą dwójki.
+ * @param mask Rozmiar tablicy pomniejszony o 1.
+ * @param node Wierzchołek.
+ *
+ * @return Indeks wierzchołka lub puste miejsce, w którym należy go umieścić.
+ */
+static struct NodeIndex *
+findIndex(const struct NodeIndex *table, size_t mask, const rt *node)
+{
+	uint64_t hash = (uintptr_t)node;
+	hash ^= hash >> 31;
+	hash *= 0x9E3779B97F4A7C15ULL;
+	hash ^= hash >> 29;
+	for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+		if (!table[i].node || table[i].node == node)
+			return (struct NodeIndex*)&table[i];
+	}
+}
+
+/**
+ * @brief Zlicza wierzchołki poddrzewa i rozmiar ich upakowanych etykiet.
+ *
+ * @param arg Korzeń poddrzewa.
+ * @param[in,out] nodes Licznik wierzchołków.
+ * @param[in,out] bytes Licznik bajtów etykiet.
+ * @param[in,out] words Licznik wierzchołków, które są przekierowane lub na
+ * które są przekierowania.
+ */
+static void
+measureTree(const rt *arg, size_t *nodes, size_t *bytes, size_t *words)
+{
+	++*nodes;
+	*bytes += digitsSize(arg->labelLength);
+	*words += arg->fwd || arg->sources;
+	for (unsigned i = 0; i < childCount(arg); ++i)
+		measureTree(arg->children[i], nodes, bytes, words);
+}
+
+/**
+ * @brief Wyznacza wierzchołki poddrzewa, które trafią do pliku, i zlicza je.
+ * Pomijane są poddrzewa bez słów, które phfwdRemove() zostawia po odcięciu
+ * gałęzi, bo phfwdLoad() odrzuca liście niebędące słowami.
+ *
+ * @param arg Korzeń poddrzewa.
+ * @param[out] skip Tablica indeksowana porządkiem preorder wszystkich
+ * wierzchołków poddrzewa: 0 dla zapisywanego wierzchołka, a dla korzenia
+ * pomijanego poddrzewa liczba jego wierzchołków.
+ * @param[in,out] nodes Licznik zapisywanych wierzchołków.
+ * @param[in,out] bytes Licznik bajtów ich etykiet.
+ * @param[in,out] words Licznik zapisywanych wierzchołków, które są
+ * przekierowane lub na które są przekierowania.
+ *
+ * @return Liczba wszystkich wierzchołków poddrzewa.
+ */
+static size_t
+markTree(const rt *arg, size_t *skip, size_t *nodes, size_t *bytes,
+         size_t *words)
+{
+	size_t all = 1, kept = 1, size = digitsSize(arg->labelLength);
+	size_t found = arg->fwd || arg->sources;
+	for (unsigned i = 0; i < childCount(arg); ++i)
+		all += markTree(arg->children[i], skip + all, &kept, &size,
+		                &found);
+	if (!found && arg->parent) {
+		skip[0] = all;
+		return all;
+	}
+	skip[0] = 0;
+	*nodes += kept;
+	*bytes += size;
+	*words += found;
+	return all;
+}
+
+/**
+ * @brief Zapisuje poddrzewo do bufora, pomijając poddrzewa wskazane przez
+ * markTree(). Zapamiętuje indeksy wierzchołków, na które są przekierowania,
+ * więc drzewo "to" trzeba zapisać przed drzewem "from".
+ *
+ * @param arg Korzeń poddrzewa, który nie jest pomijany.
+ * @param out Miejsca w buforze.
+ */
+static void
+saveTree(const rt *arg, struct SaveCursor *out)
+{
+	struct SaveNode *rec = out->nodes++;
+	size_t size = digitsSize(arg->labelLength);
+	memcpy(out->labels, labelOf(arg), size);
+	/* Nieużywana połowa ostatniego bajtu etykiety w pamięci może zawierać
+	 * pozostałość po dawnej, dłuższej etykiecie. */
+	if (arg->labelLength % 2)
+		out->labels[size - 1] &= 0xF;
+	out->labels += size;
+	if (arg->fwd) {
+		const struct NodeIndex *to = findIndex(out->targets, out->mask,
+		                                       arg->fwd);
+		*out->links++ = (struct SaveLink){out->next, to->idx};
+	}
+	if (arg->sources) {
+		*findIndex(out->targets, out->mask, arg) =
+			(struct NodeIndex){arg, out->next};
+	}
+	++out->next;
+	++out->skip;
+	uint16_t mask = 0;
+	for (unsigned i = 0; i < childCount(arg); ++i) {
+		const rt *child = arg->children[i];
+		if (*out->skip) {
+			out->skip += *out->skip;
+			continue;
+		}
+		mask |= 1u << firstDigit(child);
+		saveTree(child, out);
+	}
+	*rec = (struct SaveNode){arg->labelLength, mask, 0};
+}
+
+/**
+ * @brief Zapisuje cały bufor do deskryptora pliku.
+ *
+ * @param fd Deskryptor.
+ * @param buf Bufor.
+ * @param size Rozmiar bufora.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu zapisu.
+ */
+static bool
+writeAll(int fd, const uint8_t *buf, size_t size)
+{
+	while (size > 0) {
+		ssize_t done = write(fd, buf, size);
+		if (done < 0 && errno == EINTR) continue;
+		if (done <= 0) return false;
+		buf += done;
+		size -= done;
+	}
+	return true;
+}
+
+/**
+ * @brief Wczytuje wszystkie dane z deskryptora pliku do bufora.
+ *
+ * @param fd Deskryptor.
+ * @param[out] size Liczba wczytanych bajtów.
+ *
+ * @return Bufor zaalokowany przez malloc() lub NULL w przypadku błędu
+ * alokacji lub odczytu.
+ */
+static uint8_t *
+readAll(int fd, size_t *size)
+{
+	size_t cap = LOAD_MIN_BUFFER;
+	uint8_t *buf = malloc(cap);
+	*size = 0;
+	while (buf) {
+		if (*size == cap) {
+			uint8_t *new = realloc(buf, 2 * cap);
+			if (!new) break;
+			buf = new;
+			cap *= 2;
+		}
+		ssize_t done = read(fd, buf + *size, cap - *size);
+		if (done < 0 && errno == EINTR) continue;
+		if (done < 0) break;
+		if (done == 0) return buf;
+		*size += done;
+	}
+	free(buf);
+	return NULL;
+}
+
+/**
+ * @brief Sprawdza, czy upakowana etykieta składa się z cyfr, a nieużywana
+ * połowa ostatniego bajtu jest zerem.
+ *
+ * @param arg Upakowana etykieta.
+ * @param len Długość etykiety.
+ */
+static bool
+validLabel(const uint8_t *arg, size_t len)
+{
+	for (size_t i = 0; i < len / 2; ++i) {
+		if ((arg[i] & 0xF) >= DIGITS || arg[i] >> 4 >= DIGITS)
+			return false;
+	}
+	return len % 2 == 0 || arg[len / 2] < DIGITS;
+}
+
+/**
+ * Wierzchołek na stosie odtwarzanego drzewa.
+ */
+struct LoadEntry {
+	rt *node; ///< Wierzchołek.
+	unsigned pending; ///< Pierwsze cyfry dzieci, które nie zostały jeszcze
+	                  ///< odtworzone.
+	size_t depth; ///< Długość słowa odpowiadającego wierzchołkowi.
+};
+
+/**
+ * Dane wczytanego pliku potrzebne do odtworzenia drzewa.
+ */
+struct LoadSource {
+	const struct SaveNode *nodes; ///< Rekordy wierzchołków drzewa.
+	size_t count; ///< Liczba wierzchołków drzewa.
+	const uint8_t *labels; ///< Następna etykieta.
+	const uint8_t *labelEnd; ///< Koniec etykiet.
+	const bool *words; ///< Czy wierzchołek jest przekierowany lub są na niego
+	                   ///< przekierowania.
+	char *path; ///< Bufor na słowo bieżącego wierzchołka.
+};
+
+/**
+ * @brief Odtwarza drzewo z rekordów wierzchołków.
+ * Sprawdza, czy rekordy opisują poprawne drzewo: dzieci są zgodne z maskami,
+ * etykiety są niepuste i składają się z cyfr, a każdy liść jest słowem.
+ *
+ * @param mem Alokator drzewa.
+ * @param root Korzeń pustego drzewa.
+ * @param arg Dane pliku. Funkcja przesuwa @p arg->labels za etykiety drzewa.
+ * @param[out] index Wierzchołki w kolejności rekordów.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji lub
+ * niepoprawnych danych.
+ */
+static bool
+loadTree(struct Arena *mem, rt *root, struct LoadSource *arg, rt **index)
+{
+	struct LoadEntry *stack = malloc(arg->count * sizeof(struct LoadEntry));
+	if (!stack) return false;
+	size_t top = 0;
+	bool ret = false;
+	for (size_t i = 0; i < arg->count; ++i) {
+		const struct SaveNode *rec = &arg->nodes[i];
+		size_t len = rec->labelLength, size = digitsSize(len);
+		unsigned count = popcount16(rec->childMask);
+		if (rec->childMask >> DIGITS || rec->reserved
+		    || (size_t)(arg->labelEnd - arg->labels) < size
+		    || !validLabel(arg->labels, len)
+		    || (i > 0 && (!len || (!arg->words[i] && !count))))
+			goto free_stack;
+		while (top > 0 && !stack[top - 1].pending)
+			--top;
+		if ((i == 0) != (top == 0) || (i == 0 && len))
+			goto free_stack;
+
+		rt *node = root;
+		size_t depth = 0;
+		if (i > 0) {
+			struct LoadEntry *parent = &stack[top - 1];
+			unsigned digit = 0;
+			while (!(parent->pending >> digit & 1))
+				++digit;
+			if ((arg->labels[0] & 0xF) != digit)
+				goto free_stack;
+			parent->pending &= parent->pending - 1;
+			node = makeRT(mem);
+			if (!node) goto free_stack;
+			if (len > LABEL_INLINE) {
+				node->label.ptr = arenaAlloc(mem, size);
+				if (!node->label.ptr) goto free_stack;
+			}
+			node->labelLength = len;
+			memcpy((uint8_t*)labelOf(node), arg->labels, size);
+			node->charset = digitsCharset(labelOf(node), 0, len);
+			node->parent = parent->node;
+			parent->node->children[childCount(parent->node)] = node;
+			parent->node->childMask |= 1u << digit;
+			depth = parent->depth + len;
+			digitsUnpack(arg->path + parent->depth, labelOf(node), 0, len);
+		}
+		arg->labels += size;
+		if (arg->words[i]) {
+			node->fullWord = arenaCopy(mem, arg->path, arg->path + depth);
+			if (!node->fullWord) goto free_stack;
+		}
+		if (count) {
+			node->childCap = childCapFor(count);
+			node->children = arenaAlloc(mem, node->childCap * sizeof(rt*));
+			if (!node->children) goto free_stack;
+			stack[top++] = (struct LoadEntry){node, rec->childMask, depth};
+		}
+		index[i] = node;
+	}
+	while (top > 0 && !stack[top - 1].pending)
+		--top;
+	ret = top == 0;
+
+free_stack:
+	free(stack);
+	return ret;
+}
+
+/**
+ * @brief Odtwarza strukturę z wczytanego pliku.
+ *
+ * @param buf Zawartość pliku.
+ * @param size Rozmiar pliku.
+ *
+ * @return Wskaźnik na strukturę lub NULL w przypadku błędu alokacji lub
+ * niepoprawnych danych.
+ */
+static struct PhoneForward *
+loadImage(const uint8_t *buf, size_t size)
+{
+	struct SaveHeader head;
+	if (size < sizeof(head)) return NULL;
+	memcpy(&head, buf, sizeof(head));
+	if (memcmp(head.magic, SAVE_MAGIC, sizeof(head.magic))
+	    || head.version != SAVE_VERSION || head.byteOrder != SAVE_BYTE_ORDER
+	    || head.reserved)
+		return NULL;
+	for (unsigned t = 0; t < 2; ++t) {
+		if (head.nodes[t] < 1 || head.nodes[t] > UINT32_MAX)
+			return NULL;
+	}
+	if (head.links >= head.nodes[0] || head.labelBytes > size)
+		return NULL;
+	size_t records = head.nodes[0] + head.nodes[1];
+	size_t fixed = sizeof(head) + records * sizeof(struct SaveNode)
+	               + head.links * sizeof(struct SaveLink);
+	if (fixed + head.labelBytes != size)
+		return NULL;
+
+	const struct SaveNode *nodes = (const void*)(buf + sizeof(head));
+	const struct SaveLink *links = (const void*)(nodes + records);
+	bool *words = calloc(records, sizeof(bool));
+	size_t *filled = calloc(head.nodes[1], sizeof(size_t));
+	rt **index = malloc(records * sizeof(rt*));
+	char *path = malloc(2 * head.labelBytes + 1);
+	struct PhoneForward *pf = phfwdNew();
+	bool ret = words && filled && index && path && pf;
+
+	/* Przekierowania muszą być posortowane według słów przekierowywanych,
+	 * a więc i różne. */
+	for (size_t i = 0; ret && i < head.links; ++i) {
+		const struct SaveLink *l = &links[i];
+		ret = l->from > 0 && l->from < head.nodes[0]
+		      && l->to > 0 && l->to < head.nodes[1]
+		      && (i == 0 || links[i - 1].from < l->from);
+		if (ret) {
+			words[l->from] = true;
+			words[head.nodes[0] + l->to] = true;
+			++filled[l->to];
+		}
+	}
+	if (ret) {
+		struct LoadSource src = {nodes, head.nodes[0], buf + fixed,
+		                         buf + size, words, path};
+		ret = loadTree(&pf->mem, pf->from, &src, index);
+		src.nodes += head.nodes[0];
+		src.count = head.nodes[1];
+		src.words += head.nodes[0];
+		ret = ret && loadTree(&pf->mem, pf->to, &src, index + head.nodes[0]);
+	}
+	for (size_t i = 0; ret && i < head.nodes[1]; ++i) {
+		if (!filled[i]) continue;
+		rt *to = index[head.nodes[0] + i];
+		to->sources = arenaAlloc(&pf->mem, sourcesSize(filled[i]));
+		if (!to->sources) {ret = false; break;}
+		to->sources->count = to->sources->cap = filled[i];
+		to->sources->bytes = 0;
+		filled[i] = 0;
+		++pf->targets;
+	}
+	for (size_t i = 0; ret && i < head.links; ++i) {
+		rt *from = index[links[i].from];
+		rt *to = index[head.nodes[0] + links[i].to];
+		if (!strcmp(from->fullWord, to->fullWord)) {
+			ret = false;
+			break;
+		}
+		from->fwd = to;
+		to->sources->item[filled[links[i].to]++] =
+			(struct Source){from->fullWord, from};
+		to->sources->bytes += strlen(from->fullWord);
+	}
+	ret = ret && countBulk(&pf->counts, pf->to, 0, 0, false);
+	free(words);
+	free(filled);
+	free(index);
+	free(path);
+	if (!ret) {
+		phfwdDelete(pf);
+		return NULL;
+	}
+	return pf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Zamrożona struktura
+//
+// phfwdFreeze() zapisuje obie struktury drzew w postaci bez wskaźników, którą
+// phfwdFrozenOpen() i phfwdFrozenMap() udostępniają zapytaniom bez żadnego
+// przetwarzania. Wierzchołki każdego drzewa leżą w porządku BFS, więc dzieci
+// wierzchołka zajmują ciągły przedział tablicy, a wierzchołki bliskie korzenia,
+// odwiedzane przez każde zapytanie, leżą obok siebie. Etykiety są zapisane
+// jako znaki w jednej tablicy, a słowa, na które są przekierowania, i słowa
+// przekierowane - jako napisy w drugiej. Zamiast wskaźników wierzchołki
+// przechowują indeksy i przesunięcia.
+//
+// Plik składa się z nagłówka FrozenHeader i kolejnych sekcji: wierzchołków
+// drzewa "from", wierzchołków drzewa "to", źródeł, początków poziomów
+// liczników, liczników, etykiet i słów. Każda sekcja zaczyna się od
+// przesunięcia podzielnego przez FROZEN_ALIGN.
+
+/**
+ * Nagłówek zamrożonej struktury.
+ */
+struct FrozenHeader {
+	char magic[4]; ///< FROZEN_MAGIC.
+	uint32_t version; ///< FROZEN_VERSION.
+	uint32_t byteOrder; ///< SAVE_BYTE_ORDER.
+	uint32_t reserved; ///< Zero.
+	uint64_t nodes[2]; ///< Liczba wierzchołków drzew "from" i "to".
+	uint64_t sources; ///< Łączna liczba źródeł.
+	uint64_t levels; ///< Liczba poziomów liczników.
+	uint64_t terms; ///< Łączna liczba liczników.
+	uint64_t labelBytes; ///< Łączna długość etykiet.
+	uint64_t wordBytes; ///< Łączny rozmiar słów wraz ze znakami '\0'.
+};
+
+/**
+ * Wierzchołek zamrożonego drzewa.
+ */
+struct FrozenNode {
+	uint32_t label; ///< Przesunięcie etykiety w tablicy etykiet.
+	uint32_t labelLength; ///< Długość etykiety.
+	uint32_t firstChild; ///< Indeks pierwszego dziecka.
+	/** W drzewie "from": przesunięcie słowa, na które wierzchołek jest
+	 * przekierowany. W drzewie "to": indeks pierwszego źródła. */
+	uint32_t data;
+	/** W drzewie "from": 1, jeśli wierzchołek jest przekierowany, lub 0.
+	 * W drzewie "to": liczba źródeł. */
+	uint32_t dataCount;
+	uint16_t childMask; ///< Zbiór pierwszych cyfr etykiet dzieci.
+	uint16_t reserved; ///< Zero.
+};
+
+/**
+ * Licznik minimalnych nietrywialnych słów w zamrożonej strukturze.
+ */
+struct FrozenTerm {
+	uint64_t count; ///< Liczba słów.
+	uint32_t mask; ///< Zakodowany przez charset() zbiór cyfr słów.
+	uint32_t reserved; ///< Zero.
+};
+
+/**
+ * Przesunięcia sekcji zamrożonej struktury.
+ */
+struct FrozenLayout {
+	size_t nodes[2]; ///< Wierzchołki drzew "from" i "to".
+	size_t sources; ///< Źródła: przesunięcia słów przekierowanych.
+	size_t levels; ///< Indeksy pierwszych liczników kolejnych poziomów.
+	size_t terms; ///< Liczniki.
+	size_t labels; ///< Etykiety.
+	size_t words; ///< Słowa.
+	size_t size; ///< Rozmiar całej struktury.
+};
+
+/**
+ * Zamrożona struktura przechowująca przekierowania.
+ */
+struct PhoneForwardFrozen {
+	const uint8_t *data; ///< Początek struktury.
+	size_t size; ///< Rozmiar struktury.
+	bool mapped; ///< Czy struktura została odwzorowana przez mmap().
+	const struct FrozenNode *nodes[2]; ///< Wierzchołki drzew.
+	const uint32_t *sources; ///< Przesunięcia słów przekierowanych.
+	const uint64_t *levels; ///< Początki poziomów liczników.
+	size_t levelCount; ///< Liczba poziomów liczników.
+	const struct FrozenTerm *terms; ///< Liczniki.
+	const char *labels; ///< Etykiety.
+	const char *words; ///< Słowa.
+};
+
+/**
+ * Miejsca, do których freezeTree() zapisuje etykiety, źródła i słowa.
+ */
+struct FreezeCursor {
+	char *labels; ///< Tablica etykiet.
+	uint32_t labelPos; ///< Pierwsze wolne miejsce w tablicy etykiet.
+	char *words; ///< Tablica słów.
+	uint32_t wordPos; ///< Pierwsze wolne miejsce w tablicy słów.
+	uint32_t *sources; ///< Tablica źródeł.
+	uint32_t sourcePos; ///< Pierwsze wolne miejsce w tablicy źródeł.
+	struct NodeIndex *targets; ///< Przesunięcia słów wierzchołków drzewa "to".
+	size_t mask; ///< Rozmiar tablicy @p targets pomniejszony o 1.
+};
+
+/**
+ * @brief Zaokrągla rozmiar w górę do wielokrotności FROZEN_ALIGN.
+ *
+ * @param size Rozmiar.
+ */
+static inline size_t
+frozenAlign(size_t size)
+{
+	return (size + FROZEN_ALIGN - 1) / FROZEN_ALIGN * FROZEN_ALIGN;
+}
+
+/**
+ * @brief Wyznacza przesunięcia sekcji zamrożonej struktury.
+ *
+ * @param head Nagłówek.
+ * @param[out] out Przesunięcia sekcji.
+ *
+ * @return true, jeśli rozmiary sekcji mieszczą się w formacie, lub false
+ * w przeciwnym przypadku.
+ */
+static bool
+frozenLayout(const struct FrozenHeader *head, struct FrozenLayout *out)
+{
+	if (head->nodes[0] > UINT32_MAX || head->nodes[1] > UINT32_MAX
+	    || head->sources > UINT32_MAX || head->levels > UINT32_MAX
+	    || head->terms > UINT32_MAX || head->labelBytes > UINT32_MAX
+	    || head->wordBytes > UINT32_MAX)
+		return false;
+	size_t pos = frozenAlign(sizeof(struct FrozenHeader));
+	for (unsigned t = 0; t < 2; ++t) {
+		out->nodes[t] = pos;
+		pos = frozenAlign(pos + head->nodes[t] * sizeof(struct FrozenNode));
+	}
+	out->sources = pos;
+	pos = frozenAlign(pos + head->sources * sizeof(uint32_t));
+	out->levels = pos;
+	pos = frozenAlign(pos + (head->levels + 1) * sizeof(uint64_t));
+	out->terms = pos;
+	pos = frozenAlign(pos + head->terms * sizeof(struct FrozenTerm));
+	out->labels = pos;
+	pos = frozenAlign(pos + head->labelBytes);
+	out->words = pos;
+	out->size = pos + head->wordBytes;
+	return true;
+}
+
+/**
+ * @brief Zlicza wierzchołki, długość etykiet, źródła i rozmiar słów
+ * poddrzewa.
+ *
+ * @param arg Korzeń poddrzewa.
+ * @param[in,out] head Nagłówek, którego liczniki funkcja zwiększa.
+ * @param tree Indeks drzewa: 0 dla "from", 1 dla "to".
+ * @param[in,out] targets Licznik wierzchołków, na które są przekierowania.
+ */
+static void
+measureFrozen(const rt *arg, struct FrozenHeader *head, unsigned tree,
+              size_t *targets)
+{
+	++head->nodes[tree];
+	head->labelBytes += arg->labelLength;
+	if (arg->sources) {
+		++*targets;
+		head->sources += arg->sources->count;
+		head->wordBytes += strlen(arg->fullWord) + 1 + arg->sources->bytes
+		                   + arg->sources->count;
+	}
+	for (unsigned i = 0; i < childCount(arg); ++i)
+		measureFrozen(arg->children[i], head, tree, targets);
+}
+
+/**
+ * @brief Dopisuje napis do tablicy słów.
+ *
+ * @param cur Miejsca zapisu.
+ * @param word Napis.
+ *
+ * @return Przesunięcie napisu w tablicy słów.
+ */
+static uint32_t
+freezeWord(struct FreezeCursor *cur, const char *word)
+{
+	uint32_t ret = cur->wordPos;
+	size_t len = strlen(word) + 1;
+	memcpy(cur->words + ret, word, len);
+	cur->wordPos += len;
+	return ret;
+}
+
+/**
+ * @brief Zapisuje drzewo w porządku BFS.
+ * Drzewo "to" należy zapisać przed drzewem "from", bo wierzchołki "from"
+ * odwołują się do słów zapisanych przy wierzchołkach "to".
+ *
+ * @param root Korzeń drzewa.
+ * @param count Liczba wierzchołków drzewa.
+ * @param[out] out Tablica wierzchołków.
+ * @param cur Miejsca zapisu pozostałych danych.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+freezeTree(const rt *root, size_t count, struct FrozenNode *out,
+           struct FreezeCursor *cur)
+{
+	const rt **queue = malloc(count * sizeof(rt*));
+	if (!queue) return false;
+	size_t tail = 0;
+	queue[tail++] = root;
+	for (size_t i = 0; i < count; ++i) {
+		const rt *arg = queue[i];
+		struct FrozenNode *node = &out[i];
+		*node = (struct FrozenNode){cur->labelPos, arg->labelLength, tail, 0, 0,
+		                            arg->childMask, 0};
+		digitsUnpack(cur->labels + cur->labelPos, labelOf(arg), 0,
+		             arg->labelLength);
+		cur->labelPos += arg->labelLength;
+		for (unsigned j = 0; j < childCount(arg); ++j)
+			queue[tail++] = arg->children[j];
+
+		if (arg->sources) {
+			*findIndex(cur->targets, cur->mask, arg) =
+				(struct NodeIndex){arg, freezeWord(cur, arg->fullWord)};
+			node->data = cur->sourcePos;
+			node->dataCount = arg->sources->count;
+			for (size_t j = 0; j < arg->sources->count; ++j) {
+				cur->sources[cur->sourcePos++] =
+					freezeWord(cur, arg->sources->item[j].word);
+			}
+		} else if (arg->fwd) {
+			node->data = findIndex(cur->targets, cur->mask, arg->fwd)->idx;
+			node->dataCount = 1;
+		}
+	}
+	free(queue);
+	return true;
+}
+
+/**
+ * @brief Sprawdza wierzchołki zamrożonego drzewa.
+ * Wszystkie przesunięcia i indeksy muszą wskazywać wnętrze odpowiednich
+ * tablic, dzieci muszą leżeć za rodzicem, a etykiety wierzchołków innych niż
+ * korzeń muszą być niepuste.
+ *
+ * @param arg Zamrożona struktura z ustawionymi wskaźnikami sekcji.
+ * @param head Nagłówek.
+ * @param tree Indeks drzewa: 0 dla "from", 1 dla "to".
+ *
+ * @return true, jeśli wierzchołki są poprawne, lub false w przeciwnym
+ * przypadku.
+ */
+static bool
+validFrozenTree(const struct PhoneForwardFrozen *arg,
+                const struct FrozenHeader *head, unsigned tree)
+{
+	size_t count = head->nodes[tree];
+	for (size_t i = 0; i < count; ++i) {
+		const struct FrozenNode *node = &arg->nodes[tree][i];
+		unsigned children = popcount16(node->childMask);
+		if (node->childMask >> DIGITS || node->reserved
+		    || (i > 0) != (node->labelLength > 0)
+		    || (uint64_t)node->label + node->labelLength > head->labelBytes
+		    || (children && (node->firstChild <= i
+		                     || node->firstChild + children > count)))
+			return false;
+		if (tree == 0 && (node->dataCount > 1
+		                  || (node->dataCount && node->data
+		                                         >= head->wordBytes)))
+			return false;
+		if (tree == 1 && (uint64_t)node->data + node->dataCount
+		                 > head->sources)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Udostępnia zamrożoną strukturę zapisaną w pamięci.
+ * Sprawdza, czy dane są poprawne, więc zapytania nie wyjdą poza nie nawet
+ * dla uszkodzonego pliku.
+ *
+ * @param data Początek struktury, wyrównany do FROZEN_ALIGN.
+ * @param size Rozmiar struktury.
+ * @param mapped Czy struktura została odwzorowana przez mmap().
+ *
+ * @return Wskaźnik na strukturę lub NULL w przypadku błędu alokacji lub
+ * niepoprawnych danych.
+ */
+static struct PhoneForwardFrozen *
+frozenOpen(const uint8_t *data, size_t size, bool mapped)
+{
+	struct FrozenHeader head;
+	struct FrozenLayout layout;
+	if (size < sizeof(head) || (uintptr_t)data % FROZEN_ALIGN) return NULL;
+	memcpy(&head, data, sizeof(head));
+	if (memcmp(head.magic, FROZEN_MAGIC, sizeof(head.magic))
+	    || head.version != FROZEN_VERSION || head.byteOrder != SAVE_BYTE_ORDER
+	    || head.reserved || head.nodes[0] < 1 || head.nodes[1] < 1
+	    || !frozenLayout(&head, &layout) || layout.size != size)
+		return NULL;
+
+	struct PhoneForwardFrozen *new = malloc(sizeof(struct PhoneForwardFrozen));
+	if (!new) return NULL;
+	*new = (struct PhoneForwardFrozen){
+		data, size, mapped,
+		{(const void*)(data + layout.nodes[0]),
+		 (const void*)(data + layout.nodes[1])},
+		(const void*)(data + layout.sources),
+		(const void*)(data + layout.levels), head.levels,
+		(const void*)(data + layout.terms),
+		(const char*)(data + layout.labels),
+		(const char*)(data + layout.words)
+	};
+	bool ret = validFrozenTree(new, &head, 0) && validFrozenTree(new, &head, 1)
+	           && (!head.wordBytes || !new->words[head.wordBytes - 1])
+	           && new->levels[0] == 0 && new->levels[head.levels] == head.terms;
+	for (size_t i = 0; ret && i < head.sources; ++i)
+		ret = new->sources[i] < head.wordBytes;
+	for (size_t d = 0; ret && d < head.levels; ++d)
+		ret = new->levels[d] <= new->levels[d + 1];
+	if (!ret) {
+		free(new);
+		return NULL;
+	}
+	return new;
+}
+
+/**
+ * @brief Wyznacza dziecko wierzchołka zamrożonego drzewa, którego etykieta
+ * jest prefiksem sufiksu numeru.
+ *
+ * @param nodes Wierzchołki drzewa.
+ * @param labels Etykiety.
+ * @param arg Wierzchołek.
+ * @param num Sufiks numeru, niepusty.
+ * @param len Długość sufiksu.
+ *
+ * @return Dziecko lub NULL, jeśli takiego nie ma.
+ */
+static const struct FrozenNode *
+frozenChild(const struct FrozenNode *nodes, const char *labels,
+            const struct FrozenNode *arg, const char *num, size_t len)
+{
+	unsigned digit = num[0] - '0';
+	if (!(arg->childMask >> digit & 1)) return NULL;
+	const struct FrozenNode *child =
+		&nodes[arg->firstChild + popcount16(arg->childMask
+		                                    & ((1u << digit) - 1))];
+	if (child->labelLength > len
+	    || memcmp(labels + child->label, num, child->labelLength))
+		return NULL;
+	return child;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Zwięzła struktura
+//
+// phfwdSuccinctNew() koduje oba drzewa w postaci LOUDS. Wierzchołki są
+// ponumerowane w porządku BFS, a każdy z nich zapisuje w wektorze bitów tyle
+// jedynek, ile ma dzieci, i jedno zero. Jedynki wierzchołka i leżą za jego
+// i zerami, więc jego dzieci mają kolejne numery zaczynające się od liczby
+// jedynek przed nimi powiększonej o 1, a rodzicem wierzchołka c jest liczba
+// zer przed (c-1)-szą jedynką. Dzieci i rodzica wyznaczają więc operacje rank
+// i select zamiast wskaźników.
+//
+// Etykiety wierzchołków innych niż korzeń leżą w tej samej kolejności w jednym
+// upakowanym ciągu cyfr, a drugi wektor bitów oznacza ich początki. Etykiety
+// rodzeństwa sąsiadują ze sobą, więc dziecko o danej pierwszej cyfrze jest
+// wyszukiwane przez przejście po kolejnych początkach. Słowa nie są
+// przechowywane: zapytania odtwarzają je z etykiet na ścieżce do korzenia.
+// Trzeci wektor bitów oznacza wierzchołki przekierowane i te, na które są
+// przekierowania, a ich rank indeksuje tablice numerów wierzchołków drugiego
+// drzewa.
+//
+// Wierzchołek zajmuje w ten sposób około 3 bitów i pół bajtu na każdą cyfrę
+// etykiety, a przekierowanie 8 bajtów, kosztem wolniejszych zapytań.
+
+/**
+ * Drzewo w postaci LOUDS.
+ */
+struct SuccinctTree {
+	struct BitVector louds; ///< Liczby dzieci kolejnych wierzchołków.
+	/** Początki etykiet w ciągu cyfr i dodatkowa jedynka za ostatnią. */
+	struct BitVector starts;
+	/** W drzewie "from": wierzchołki przekierowane. W drzewie "to":
+	 * wierzchołki, na które są przekierowania. */
+	struct BitVector marked;
+	uint8_t *labels; ///< Upakowane etykiety.
+	size_t digits; ///< Łączna długość etykiet.
+	size_t maxLength; ///< Długość najdłuższego słowa oznaczonego wierzchołka.
+};
+
+/**
+ * Zwięzła kopia struktury przechowującej przekierowania.
+ */
+struct PhoneForwardSuccinct {
+	struct SuccinctTree trees[2]; ///< Drzewa "from" i "to".
+	/** Numery wierzchołków drzewa "to", na które są przekierowane kolejne
+	 * oznaczone wierzchołki drzewa "from". */
+	uint32_t *targets;
+	/** Numery wierzchołków drzewa "from" przekierowanych na kolejne
+	 * oznaczone wierzchołki drzewa "to". */
+	uint32_t *sources;
+	/** Indeksy w tablicy @p sources pierwszych źródeł kolejnych oznaczonych
+	 * wierzchołków drzewa "to" i łączna liczba źródeł. */
+	uint32_t *firstSource;
+};
+
+/**
+ * Oznaczony wierzchołek na ścieżce numeru w drzewie "to".
+ */
+struct SuccinctStep {
+	size_t rank; ///< Numer wierzchołka wśród oznaczonych.
+	size_t pos; ///< Długość słowa wierzchołka.
+};
+
+/**
+ * @brief Wypisuje wierzchołki drzewa w porządku BFS.
+ *
+ * @param root Korzeń drzewa.
+ * @param[out] count Liczba wierzchołków.
+ *
+ * @return Tablica wierzchołków, którą należy zwolnić funkcją free(), lub NULL
+ * w przypadku błędu alokacji.
+ */
+static const rt **
+succinctQueue(const rt *root, size_t *count)
+{
+	size_t bytes = 0, words = 0;
+	*count = 0;
+	measureTree(root, count, &bytes, &words);
+	const rt **queue = malloc(*count * sizeof(rt*));
+	if (!queue) return NULL;
+	size_t tail = 0;
+	queue[tail++] = root;
+	for (size_t i = 0; i < *count; ++i) {
+		for (unsigned j = 0; j < childCount(queue[i]); ++j)
+			queue[tail++] = queue[i]->children[j];
+	}
+	return queue;
+}
+
+/**
+ * @brief Koduje drzewo w postaci LOUDS i zapamiętuje numery jego
+ * oznaczonych wierzchołków.
+ *
+ * @param[out] out Drzewo. Należy je zwolnić funkcją succinctFree(), także
+ * w przypadku błędu.
+ * @param queue Wierzchołki drzewa w porządku BFS.
+ * @param count Liczba wierzchołków.
+ * @param tree Indeks drzewa: 0 dla "from", 1 dla "to".
+ * @param table Tablica indeksów.
+ * @param mask Rozmiar tablicy pomniejszony o 1.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+succinctTree(struct SuccinctTree *out, const rt *const *queue, size_t count,
+             unsigned tree, struct NodeIndex *table, size_t mask)
+{
+	*out = (struct SuccinctTree){{NULL, NULL, 0, 0}, {NULL, NULL, 0, 0},
+	                             {NULL, NULL, 0, 0}, NULL, 0, 0};
+	for (size_t i = 0; i < count; ++i)
+		out->digits += queue[i]->labelLength;
+	out->labels = calloc(digitsSize(out->digits + 1), 1);
+	if (!out->labels || !bitsInit(&out->louds, 2 * count - 1)
+	    || !bitsInit(&out->starts, out->digits + 1)
+	    || !bitsInit(&out->marked, count))
+		return false;
+
+	size_t pos = 0, off = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const rt *arg = queue[i];
+		for (unsigned j = 0; j < childCount(arg); ++j)
+			bitsSet(&out->louds, pos++);
+		++pos;
+		if (i > 0) {
+			bitsSet(&out->starts, off);
+			digitsCopy(out->labels, off, labelOf(arg), 0, arg->labelLength);
+			off += arg->labelLength;
+		}
+		if (tree == 0 ? arg->fwd != NULL : arg->sources != NULL) {
+			bitsSet(&out->marked, i);
+			*findIndex(table, mask, arg) = (struct NodeIndex){arg, i};
+			size_t len = strlen(arg->fullWord);
+			if (len > out->maxLength)
+				out->maxLength = len;
+		}
+	}
+	bitsSet(&out->starts, off);
+	return bitsBuild(&out->louds) && bitsBuild(&out->starts)
+	       && bitsBuild(&out->marked);
+}
+
+/**
+ * @brief Zwalnia pamięć drzewa w postaci LOUDS.
+ *
+ * @param arg Drzewo wypełnione przez succinctTree().
+ */
+static void
+succinctFree(struct SuccinctTree *arg)
+{
+	bitsFree(&arg->louds);
+	bitsFree(&arg->starts);
+	bitsFree(&arg->marked);
+	free(arg->labels);
+}
+
+/**
+ * @brief Wyznacza dziecko wierzchołka, którego etykieta jest prefiksem sufiksu
+ * numeru.
+ *
+ * @param arg Drzewo.
+ * @param node Numer wierzchołka.
+ * @param key Numer.
+ * @param[in,out] pos Długość dopasowanego prefiksu numeru, mniejsza niż jego
+ * długość. Jeśli dziecko istnieje, jest zwiększana o długość jego etykiety.
+ *
+ * @return Numer dziecka lub 0, jeśli takiego nie ma.
+ */
+static size_t
+succinctChild(const struct SuccinctTree *arg, size_t node,
+              const struct Key *key, size_t *pos)
+{
+	size_t begin = node ? bitsSelect0(&arg->louds, node - 1) + 1 : 0;
+	size_t count = bitsNext0(&arg->louds, begin) - begin;
+	if (!count) return 0;
+	size_t child = begin - node + 1;
+	size_t start = bitsSelect1(&arg->starts, child - 1);
+	unsigned digit = digitAt(key->digits, *pos);
+	for (size_t i = 0; i < count; ++i) {
+		size_t end = bitsNext1(&arg->starts, start + 1);
+		unsigned first = digitAt(arg->labels, start);
+		if (first > digit) return 0;
+		if (first == digit) {
+			size_t len = end - start;
+			if (len > key->len - *pos
+			    || digitsCommonPrefix(arg->labels, start, key->digits, *pos,
+			                          len) < len)
+				return 0;
+			*pos += len;
+			return child + i;
+		}
+		start = end;
+	}
+	return 0;
+}
+
+/**
+ * @brief Odtwarza słowo wierzchołka z etykiet na ścieżce do korzenia.
+ *
+ * @param arg Drzewo.
+ * @param node Numer wierzchołka, którego słowo ma długość co najwyżej
+ * arg->maxLength.
+ * @param[out] buf Bufor na arg->maxLength + 1 znaków. Słowo jest zapisywane
+ * na jego końcu.
+ *
+ * @return Początek słowa w buforze.
+ */
+static char *
+succinctWord(const struct SuccinctTree *arg, size_t node, char *buf)
+{
+	char *ret = buf + arg->maxLength;
+	*ret = '\0';
+	while (node) {
+		size_t start = bitsSelect1(&arg->starts, node - 1);
+		size_t len = bitsNext1(&arg->starts, start + 1) - start;
+		ret -= len;
+		digitsUnpack(ret, arg->labels, start, len);
+		node = bitsSelect1(&arg->louds, node - 1) - (node - 1);
+	}
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementacja interfejsu
+
+struct PhoneForward *
+phfwdNew(void)
+{
+	struct PhoneForward *new = malloc(sizeof(struct PhoneForward));
+	if (!new) return NULL;
+	arenaInit(&new->mem);
+	new->counts = (struct CountIndex){NULL, 0};
+	new->targets = 0;
+	new->pool = NULL;
+	new->version = 0;
+	new->snapshots = 0;
+	new->snapshotList = NULL;
+	new->snapshotCap = 0;
+	historyInit(&new->history);
+	new->from = makeRT(&new->mem);
+	new->to = makeRT(&new->mem);
+	if (!new->to || !new->from) goto alloc_error;
+	if (pthread_rwlock_init(&new->lock, NULL)) goto alloc_error;
+	return new;
+
+alloc_error:
+	arenaClear(&new->mem);
+	free(new);
+	return NULL;
+}
+
+void
+phfwdDelete(struct PhoneForward *arg)
+{
+	if (!arg)
+		return;
+	arenaClear(&arg->mem);
+	countIndexFree(&arg->counts);
+	poolDelete(arg->pool);
+	historyClear(&arg->history);
+	for (size_t i = 0; i < arg->snapshots; ++i)
+		arg->snapshotList[i]->pf = NULL;
+	free(arg->snapshotList);
+	pthread_rwlock_destroy(&arg->lock);
+	free(arg);
+}
+
+/**
+ * @brief Dodaje do struktury przekierowania z poddrzewa drzewa "from".
+ *
+ * @param dst Struktura docelowa.
+ * @param arg Wierzchołek drzewa "from" innej struktury.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+copyForwards(struct PhoneForward *dst, const rt *arg)
+{
+	if (arg->fwd && !phfwdAdd(dst, arg->fullWord, arg->fwd->fullWord))
+		return false;
+	for (unsigned i = 0; i < childCount(arg); ++i) {
+		if (!copyForwards(dst, arg->children[i]))
+			return false;
+	}
+	return true;
+}
+
+struct PhoneForward *
+phfwdCopy(struct PhoneForward *pf)
+{
+	if (!pf) return NULL;
+	struct PhoneForward *new = phfwdNew();
+	if (new && !copyForwards(new, pf->from)) {
+		phfwdDelete(new);
+		return NULL;
+	}
+	return new;
+}
+
+bool
+phfwdSetThreads(struct PhoneForward *pf, unsigned threads)
+{
+	if (!pf) return false;
+	struct Pool *pool = NULL;
+	if (threads > 1 && !(pool = poolNew(threads)))
+		return false;
+	poolDelete(pf->pool);
+	pf->pool = pool;
+	return true;
+}
+
+/**
+ * @brief Ustawia przekierowanie słowa na inne słowo. Wywołujący trzyma
+ * blokadę struktury do zapisu.
+ *
+ * @param arg Struktura przechowująca przekierowania.
+ * @param k1 Upakowane słowo przekierowywane.
+ * @param k2 Upakowane słowo, na które jest wykonywane przekierowanie.
+ * @param num1 Słowo przekierowywane.
+ * @param num2 Słowo, na które jest wykonywane przekierowanie.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+addForward(struct PhoneForward *arg, const struct Key *k1,
+           const struct Key *k2, const char *num1, const char *num2)
+{
+	rt *key1 = addKey(&arg->mem, arg->from, k1, 0);
+	rt *key2 = key1 ? addKey(&arg->mem, arg->to, k2, 0) : NULL;
+	if (!key1 || !key2) return false;
+	if (key1->fwd == key2) return true;
+
+	if (!key1->fullWord) key1->fullWord = arenaCopy(&arg->mem, num1, NULL);
+	if (!key2->fullWord) key2->fullWord = arenaCopy(&arg->mem, num2, NULL);
+	if (!key1->fullWord || !key2->fullWord) return false;
+
+	rt *oldFwd = key1->fwd;
+	size_t version = arg->version + 1;
+	bool recorded = arg->snapshots > 0;
+	if ((recorded && !historyRecord(&arg->history, num1,
+	                                oldFwd ? oldFwd->fullWord : NULL, version))
+	    || !addAsRev(arg, key1, key2)) {
+		if (recorded)
+			historyRollback(&arg->history, version);
+		cleanup(&arg->mem, key1);
+		cleanup(&arg->mem, key2);
+		return false;
+	}
+	if (oldFwd) {
+		removeAsRev(arg, key1, oldFwd);
+		key1->fwd = key2;
+		cleanup(&arg->mem, oldFwd);
+	}
+	arg->version = version;
+	return true;
+}
+
+bool
+phfwdAdd(struct PhoneForward *arg, char const *num1, char const *num2)
+{
+	if (!arg || !isNumber(num1) || !isNumber(num2) || !strcmp(num1, num2))
+		return false;
+	struct Key k1, k2;
+	if (!makeKey(&k1, num1)) return false;
+	if (!makeKey(&k2, num2)) {freeKey(&k1); return false;}
+	pthread_rwlock_wrlock(&arg->lock);
+	bool ret = addForward(arg, &k1, &k2, num1, num2);
+	pthread_rwlock_unlock(&arg->lock);
+	freeKey(&k1);
+	freeKey(&k2);
+	return ret;
+}
+
+void
+phfwdRemove(struct PhoneForward *arg, const char *key)
+{
+	if (!arg) return;
+	struct Key k;
+	if (!isNumber(key) || !makeKey(&k, key))
+		return;
+	pthread_rwlock_wrlock(&arg->lock);
+	size_t version = arg->version + 1;
+	if (arg->snapshots > 0 && !recordBranch(arg, &k, version)) {
+		historyRollback(&arg->history, version);
+	} else {
+		removeBranch(arg, &k);
+		arg->version = version;
+	}
+	pthread_rwlock_unlock(&arg->lock);
+	freeKey(&k);
+}
+
+/**
+ * @brief Wyznacza przekierowanie numeru jako parę napisów, których
+ * konkatenacja jest wynikiem.
+ *
+ * @param arg Korzeń drzewa przekierowań.
+ * @param key Numer, dla którego isNumber() zwraca true.
+ * @param[out] prefix Numer, na który przekierowano najdłuższy pasujący prefiks,
+ * lub pusty napis.
+ * @param[out] suffix Sufiks @p key za najdłuższym pasującym prefiksem.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+findForward(rt *arg, const char *key, const char **prefix, const char **suffix)
+{
+	struct Key k;
+	if (!makeKey(&k, key)) return false;
+	*prefix = "";
+	*suffix = key;
+	size_t pos = 0;
+	while (1) {
+		if (arg->fwd) {
+			*prefix = arg->fwd->fullWord;
+			*suffix = key + pos;
+		}
+		if (pos == k.len) break;
+
+		rt *child = selectChild(arg, digitAt(k.digits, pos));
+		if (!child || matchLabel(child, &k, pos) < child->labelLength)
+			break;
+		pos += child->labelLength;
+		arg = child;
+	}
+	freeKey(&k);
+	return true;
+}
+
+size_t
+phfwdGetInto(struct PhoneForward *pf, char const *num, char *buf, size_t cap)
+{
+	if (!pf || !isNumber(num)) {
+		if (cap) *buf = '\0';
+		return 0;
+	}
+	const char *prefix, *suffix;
+	if (!findForward(pf->from, num, &prefix, &suffix)) return SIZE_MAX;
+	size_t prefixLen = strlen(prefix);
+	size_t suffixLen = strlen(suffix);
+	if (prefixLen + suffixLen < cap) {
+		memcpy(buf, prefix, prefixLen);
+		memcpy(buf + prefixLen, suffix, suffixLen + 1);
+	}
+	return prefixLen + suffixLen;
+}
+
+const struct PhoneNumbers *
+phfwdGet(struct PhoneForward *argpf, char const *key)
+{
+	if (!argpf) return NULL;
+	if (!isNumber(key)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	/* Wynik zwykle mieści się w buforze na stosie; wtedy wystarczy jedno
+	 * przejście drzewa i jedna alokacja na strukturę razem z napisem. */
+	char local[KEY_INLINE + 1];
+	size_t len = phfwdGetInto(argpf, key, local, sizeof(local));
+	if (len == SIZE_MAX) return NULL;
+	size_t head = sizeof(struct PhoneNumbers) + sizeof(char*);
+	struct PhoneNumbers *new = malloc(head + len + 1);
+	if (!new) return NULL;
+	char *str = (char*)new + head;
+	if (len < sizeof(local)) {
+		memcpy(str, local, len + 1);
+	} else if (phfwdGetInto(argpf, key, str, len + 1) != len) {
+		free(new);
+		return NULL;
+	}
+	new->size = 1;
+	new->data[0] = str;
+	return new;
+}
+
+/**
+ * @brief Szacuje rozmiar wyniku phfwdReverse().
+ *
+ * @param arg Korzeń drzewa "to".
+ * @param key Numer podany w phfwdReverse().
+ * @param[out] bytes Górne ograniczenie łącznego rozmiaru wynikowych numerów
+ * wraz z kończącymi znakami '\0'.
+ *
+ * @return Górne ograniczenie liczby wynikowych numerów.
+ */
+static size_t
+reverseBound(rt *arg, const struct Key *key, size_t *bytes)
+{
+	size_t count = 1;
+	size_t pos = 0;
+	*bytes = key->len + 1;
+	while (1) {
+		if (arg->sources) {
+			count += arg->sources->count;
+			*bytes += arg->sources->bytes
+			        + arg->sources->count * (key->len - pos + 1);
+		}
+
+		if (pos == key->len) break;
+		rt *child = selectChild(arg, digitAt(key->digits, pos));
+		if (!child || matchLabel(child, key, pos) < child->labelLength)
+			break;
+		pos += child->labelLength;
+		arg = child;
+	}
+	return count;
+}
+
+const struct PhoneNumbers *
+phfwdGetBatch(struct PhoneForward *pf, char const *const *nums, size_t n)
+{
+	if (!pf || (n && !nums)) return NULL;
+	size_t count;
+	struct BatchQuery *q = makeQueries(nums, n, &count);
+	if (!q) return NULL;
+
+	bool sorted = true;
+	for (size_t i = 1; sorted && i < count; ++i)
+		sorted = strcmp(q[i - 1].num, q[i].num) <= 0;
+	if (!sorted)
+		qsort(q, count, sizeof(struct BatchQuery), queryOrder);
+
+	struct PhoneNumbers *ret = NULL;
+	if (resolveSorted(pf->from, q, count))
+		ret = packResults(q, count, n);
+	free(q);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdGetMany(struct PhoneForward *pf, char const *const *nums, size_t n)
+{
+	if (!pf || (n && !nums)) return NULL;
+	size_t count;
+	struct BatchQuery *q = makeQueries(nums, n, &count);
+	if (!q) return NULL;
+	struct PhoneNumbers *ret = NULL;
+	if (resolveInterleaved(pf->from, q, count))
+		ret = packResults(q, count, n);
+	free(q);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdReverse(struct PhoneForward *arg, char const *key)
+{
+	if (!arg) return NULL;
+	if (!isNumber(key)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	struct Key k;
+	if (!makeKey(&k, key)) return NULL;
+	size_t bytes;
+	size_t count = reverseBound(arg->to, &k, &bytes);
+	size_t head = sizeof(struct PhoneNumbers) + count * sizeof(char*);
+	struct PhoneNumbers *new = malloc(head + bytes);
+	struct RevMerge merge;
+	if (!new || !revMergeInit(&merge, arg->to, &k, NULL)) {
+		freeKey(&k);
+		free(new);
+		return NULL;
+	}
+
+	char *out = (char*)new + head;
+	const char *word, *suffix;
+	int res;
+	new->size = 0;
+	while ((res = revMergeNext(&merge, &word, &suffix)) > 0) {
+		size_t wordLen = strlen(word);
+		size_t suffixLen = strlen(suffix);
+		new->data[new->size++] = out;
+		memcpy(out, word, wordLen);
+		memcpy(out + wordLen, suffix, suffixLen + 1);
+		out += wordLen + suffixLen + 1;
+	}
+	revMergeFree(&merge);
+	freeKey(&k);
+	if (res < 0) {
+		free(new);
+		return NULL;
+	}
+	return new;
+}
+
+char const *
+phnumGet(const struct PhoneNumbers *arg, size_t idx)
+{
+	if (!arg) return NULL;
+	return idx < arg->size ? arg->data[idx] : NULL;
+}
+
+void
+phnumDelete(const struct PhoneNumbers *arg)
+{
+	if (!arg) return;
+	free((void*)arg);
+}
+
+const struct PhoneNumbers *
+phnumMerge(const struct PhoneNumbers *const *lists, size_t n)
+{
+	if (n && !lists) return NULL;
+	size_t *pos = calloc(n ? n : 1, sizeof(size_t));
+	if (!pos) return NULL;
+	size_t count = 0, bytes = 0;
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; lists[i] && j < lists[i]->size; ++j) {
+			++count;
+			bytes += strlen(lists[i]->data[j]) + 1;
+		}
+	}
+	size_t head = sizeof(struct PhoneNumbers) + count * sizeof(char*);
+	struct PhoneNumbers *new = malloc(head + bytes);
+	if (!new) {
+		free(pos);
+		return NULL;
+	}
+
+	char *out = (char*)new + head;
+	new->size = 0;
+	while (1) {
+		const char *min = NULL;
+		for (size_t i = 0; i < n; ++i) {
+			const char *num = phnumGet(lists[i], pos[i]);
+			if (num && (!min || strcmp(num, min) < 0))
+				min = num;
+		}
+		if (!min) break;
+		size_t len = strlen(min) + 1;
+		new->data[new->size++] = out;
+		memcpy(out, min, len);
+		out += len;
+		for (size_t i = 0; i < n; ++i) {
+			const char *num = phnumGet(lists[i], pos[i]);
+			if (num && !strcmp(num, new->data[new->size - 1]))
+				++pos[i];
+		}
+	}
+	free(pos);
+	return new;
+}
+
+size_t
+phfwdReverseCount(struct PhoneForward *pf, char const *num)
+{
+	if (!pf || !isNumber(num)) return 0;
+	struct Key k;
+	struct RevMerge merge;
+	if (!makeKey(&k, num)) return 0;
+	if (!revMergeInit(&merge, pf->to, &k, NULL)) {
+		freeKey(&k);
+		return 0;
+	}
+	size_t ret = 0;
+	const char *word, *suffix;
+	int res;
+	while ((res = revMergeNext(&merge, &word, &suffix)) > 0)
+		++ret;
+	revMergeFree(&merge);
+	freeKey(&k);
+	return res < 0 ? 0 : ret;
+}
+
+const struct PhoneNumbers *
+phfwdReverseLimit(struct PhoneForward *pf, char const *num, size_t k,
+                  char const *after)
+{
+	if (!pf) return NULL;
+	struct Key key;
+	if (!isNumber(num)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+	if (!makeKey(&key, num)) return NULL;
+
+	size_t bytes;
+	size_t bound = reverseBound(pf->to, &key, &bytes);
+	if (k > bound)
+		k = bound;
+	struct RevRun *found = malloc((k ? k : 1) * sizeof(struct RevRun));
+	struct RevMerge merge;
+	if (!found || !revMergeInit(&merge, pf->to, &key, after)) {
+		free(found);
+		freeKey(&key);
+		return NULL;
+	}
+
+	size_t count = 0;
+	int res = 1;
+	bytes = 0;
+	while (count < k
+	       && (res = revMergeNext(&merge, &found[count].word,
+	                              &found[count].suffix)) > 0) {
+		bytes += strlen(found[count].word) + strlen(found[count].suffix) + 1;
+		++count;
+	}
+	revMergeFree(&merge);
+
+	size_t head = sizeof(struct PhoneNumbers) + count * sizeof(char*);
+	struct PhoneNumbers *new = res < 0 ? NULL : malloc(head + bytes);
+	if (new) {
+		char *out = (char*)new + head;
+		new->size = count;
+		for (size_t i = 0; i < count; ++i) {
+			size_t wordLen = strlen(found[i].word);
+			size_t suffixLen = strlen(found[i].suffix);
+			new->data[i] = out;
+			memcpy(out, found[i].word, wordLen);
+			memcpy(out + wordLen, found[i].suffix, suffixLen + 1);
+			out += wordLen + suffixLen + 1;
+		}
+	}
+	free(found);
+	freeKey(&key);
+	return new;
+}
+
+struct PhoneReverseIter *
+phfwdReverseIterNew(struct PhoneForward *pf, char const *num)
+{
+	if (!pf) return NULL;
+	struct PhoneReverseIter *new = malloc(sizeof(struct PhoneReverseIter));
+	if (!new) return NULL;
+	new->text = NULL;
+	new->key.digits = new->key.buf;
+	new->merge = (struct RevMerge){NULL, 0, 0, NULL, NULL};
+	new->buf = NULL;
+	new->cap = 0;
+	new->word = new->suffix = NULL;
+	new->failed = new->broken = false;
+	if (!isNumber(num))
+		return new;
+
+	size_t len = strlen(num);
+	new->text = malloc(len + 1);
+	if (new->text)
+		memcpy(new->text, num, len + 1);
+	if (!new->text || !makeKey(&new->key, new->text)) {
+		free(new->text);
+		free(new);
+		return NULL;
+	}
+	if (!revMergeInit(&new->merge, pf->to, &new->key, NULL)) {
+		freeKey(&new->key);
+		free(new->text);
+		free(new);
+		return NULL;
+	}
+	return new;
+}
+
+char const *
+phfwdReverseIterNext(struct PhoneReverseIter *it)
+{
+	if (!it) return NULL;
+	it->failed = it->broken;
+	if (it->broken) return NULL;
+	if (!it->word) {
+		int res = revMergeNext(&it->merge, &it->word, &it->suffix);
+		if (res < 0) it->failed = it->broken = true;
+		if (res <= 0) return NULL;
+	}
+	size_t wordLen = strlen(it->word);
+	size_t suffixLen = strlen(it->suffix);
+	if (wordLen + suffixLen + 1 > it->cap) {
+		char *new = malloc(wordLen + suffixLen + 1);
+		if (!new) {
+			it->failed = true;
+			return NULL;
+		}
+		free(it->buf);
+		it->buf = new;
+		it->cap = wordLen + suffixLen + 1;
+	}
+	memcpy(it->buf, it->word, wordLen);
+	memcpy(it->buf + wordLen, it->suffix, suffixLen + 1);
+	it->word = it->suffix = NULL;
+	return it->buf;
+}
+
+bool
+phfwdReverseIterFailed(struct PhoneReverseIter const *it)
+{
+	return it && it->failed;
+}
+
+void
+phfwdReverseIterDelete(struct PhoneReverseIter *it)
+{
+	if (!it) return;
+	revMergeFree(&it->merge);
+	freeKey(&it->key);
+	free(it->text);
+	free(it->buf);
+	free(it);
+}
+
+/**
+ * Wzorzec zapytania phfwdNonTrivialCountPattern().
+ */
+struct Pattern {
+	/** Zakodowane przez charset() zbiory cyfr kolejnych pozycji. */
+	const unsigned *masks;
+	unsigned any; ///< Suma zbiorów @p masks.
+	/** Tablica, w której rest[i] jest liczbą ciągów cyfr pasujących do
+	 * wzorca na pozycjach od i do końca. */
+	const size_t *rest;
+	size_t len; ///< Długość wzorca.
+};
+
+/**
+ * Poddrzewo przeszukiwane jako osobne zadanie puli wątków.
+ */
+struct PatternTask {
+	const rt *node; ///< Korzeń poddrzewa; nie ma na niego przekierowań.
+	size_t pos; ///< Długość słowa odpowiadającego korzeniowi.
+	size_t result; ///< Liczba numerów z poddrzewa pasujących do wzorca.
+};
+
+/**
+ * Zlecenie przeszukania poddrzew dla puli wątków.
+ */
+struct PatternJob {
+	const struct Pattern *pattern; ///< Wzorzec.
+	struct PatternTask *tasks; ///< Poddrzewa.
+};
+
+/**
+ * @brief Sprawdza, czy etykieta dziecka pasuje do wzorca.
+ *
+ * @param arg Wierzchołek drzewa "to".
+ * @param pos Długość słowa odpowiadającego rodzicowi @p arg.
+ * @param pattern Wzorzec.
+ */
+static bool
+patternMatch(const rt *arg, size_t pos, const struct Pattern *pattern)
+{
+	if (arg->labelLength > pattern->len - pos
+	    || !subset(arg->charset, pattern->any))
+		return false;
+	const uint8_t *label = labelOf(arg);
+	for (size_t j = 0; j < arg->labelLength; ++j) {
+		if (!(pattern->masks[pos + j] >> digitAt(label, j) & 1))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Pomocnicza funkcja rekurencyjna dla phfwdNonTrivialCountPattern().
+ * Wyznacza liczbę nietrywialnych numerów pasujących do wzorca wśród
+ * rozwinięć słowa danego wierzchołka.
  *
- * @param base Podstawa.
- * @param exp Wykładnik.
+ * @param arg Wierzchołek drzewa "to", na który nie ma przekierowań.
+ * @param pos Długość słowa odpowiadającego @p arg.
+ * @param pattern Wzorzec.
  *
- * @return Wynik potęgowania @p base do @p exp.
+ * @return Liczba numerów o zadanych własnościach.
  */
 static size_t
-power(size_t base, size_t exp)
+patternCountRec(const rt *arg, size_t pos, const struct Pattern *pattern)
 {
-	size_t ret = 1;
-	while (exp) {ret *= exp%2 ? base : 1; exp /= 2; base *= base;}
+	size_t ret = 0;
+	for (unsigned i = 0; i < childCount(arg); ++i) {
+		const rt *c = arg->children[i];
+		if (!patternMatch(c, pos, pattern))
+			continue;
+		if (c->sources)
+			ret += pattern->rest[pos + c->labelLength];
+		else
+			ret += patternCountRec(c, pos + c->labelLength, pattern);
+	}
 	return ret;
 }
 
+/**
+ * @brief Przeszukuje jedno poddrzewo zlecenia. Funkcja typu PoolTask.
+ *
+ * @param ctx Zlecenie (struct PatternJob).
+ * @param idx Indeks poddrzewa.
+ */
+static void
+patternTask(void *ctx, size_t idx)
+{
+	struct PatternJob *job = ctx;
+	struct PatternTask *task = &job->tasks[idx];
+	task->result = patternCountRec(task->node, task->pos, job->pattern);
+}
 
 /**
- * @brief Pomocnicza funkcja rekurencyjna dla phfwdNonTrivialCount().
- * Wyznacza liczbę nietrywialnych numerów, takich że zbiór ich cyfr
- * jest podzbiorem @p set, a długość wynosi @p len.
+ * @brief Wyznacza wynik phfwdNonTrivialCountPattern() przy użyciu puli wątków.
+ * Rozwija kolejne poziomy drzewa, dopóki nie uzyska TASKS_PER_THREAD poddrzew
+ * na wątek, a potem przeszukuje poddrzewa równolegle.
  *
- * @param arg Drzewo "to", na którym oparte są obliczenia.
- * @param set Zakodowany przez charset() zbiór cyfr.
- * @param set_size Moc zbioru @p set
- * @param len Zadana długość nietrywialnych numerów.
+ * @param pool Pula wątków.
+ * @param root Korzeń drzewa "to".
+ * @param pattern Wzorzec.
+ * @param[out] out Wynik.
  *
- * @return Liczba numerów o zadanych własnościach.
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
  */
-static size_t
-nonTrivialCountRec(rt* arg, unsigned set, unsigned set_size, size_t len)
+static bool
+patternCountParallel(struct Pool *pool, const rt *root,
+                     const struct Pattern *pattern, size_t *out)
 {
-	if (arg->leftRev != arg)
-		return power(set_size, len);
+	size_t want = (size_t)poolSize(pool) * TASKS_PER_THREAD;
+	struct PatternTask *tasks = malloc(sizeof(struct PatternTask));
+	if (!tasks) return false;
+	tasks[0] = (struct PatternTask){root, 0, 0};
+	size_t count = 1;
+	size_t ret = 0;
+	while (count > 0 && count < want) {
+		struct PatternTask *next = malloc(count * DIGITS
+		                                  * sizeof(struct PatternTask));
+		if (!next) {
+			free(tasks);
+			return false;
+		}
+		size_t nextCount = 0;
+		for (size_t t = 0; t < count; ++t) {
+			const rt *arg = tasks[t].node;
+			size_t pos = tasks[t].pos;
+			for (unsigned i = 0; i < childCount(arg); ++i) {
+				const rt *c = arg->children[i];
+				if (!patternMatch(c, pos, pattern))
+					continue;
+				if (c->sources)
+					ret += pattern->rest[pos + c->labelLength];
+				else
+					next[nextCount++] = (struct PatternTask)
+						{c, pos + c->labelLength, 0};
+			}
+		}
+		free(tasks);
+		tasks = next;
+		count = nextCount;
+	}
 
+	struct PatternJob job = {pattern, tasks};
+	poolRun(pool, patternTask, &job, count);
+	for (size_t t = 0; t < count; ++t)
+		ret += tasks[t].result;
+	free(tasks);
+	*out = ret;
+	return true;
+}
+
+size_t
+phfwdNonTrivialCountPattern(struct PhoneForward *pf, char const *const *sets,
+                            size_t len)
+{
+	if (!pf || !sets || !len) return 0;
+	unsigned *masks = malloc(len * sizeof(unsigned));
+	size_t *rest = malloc((len + 1) * sizeof(size_t));
 	size_t ret = 0;
-	for (rt *c = arg->rightChild; c != arg; c = c->rightSibling) {
-		if (subset(c->charset, set) && c->labelLength <= len)
-			ret += nonTrivialCountRec(c, set, set_size, len - c->labelLength);
+	if (masks && rest) {
+		struct Pattern pattern = {masks, 0, rest, len};
+		rest[len] = 1;
+		for (size_t i = len; i-- > 0; ) {
+			masks[i] = sets[i] ? charset(sets[i]) : 0;
+			rest[i] = rest[i + 1] * charset_size(masks[i]);
+			pattern.any |= masks[i];
+		}
+		if (!pf->pool || pf->targets < PARALLEL_MIN_TARGETS
+		    || !patternCountParallel(pf->pool, pf->to, &pattern, &ret))
+			ret = patternCountRec(pf->to, 0, &pattern);
 	}
+	free(masks);
+	free(rest);
 	return ret;
 }
 
+/**
+ * Zlecenie obliczeń phfwdNonTrivialCountBatch() dla puli wątków. Zadanie
+ * o indeksie i obsługuje zbiory cyfr od i * @p chunk do (i + 1) * @p chunk.
+ */
+struct BatchJob {
+	const struct CountIndex *idx; ///< Liczniki.
+	struct SetQuery *q; ///< Zbiory cyfr.
+	size_t setCount; ///< Liczba zbiorów cyfr.
+	size_t chunk; ///< Liczba zbiorów cyfr na zadanie.
+	const struct LenQuery *order; ///< Długości posortowane rosnąco.
+	size_t lenCount; ///< Liczba długości.
+	size_t *out; ///< Tablica wyników.
+};
+
+/**
+ * @brief Wyznacza wyniki phfwdNonTrivialCountBatch() dla przedziału zbiorów
+ * cyfr.
+ *
+ * @param idx Liczniki.
+ * @param q Zbiory cyfr.
+ * @param begin Indeks pierwszego zbioru przedziału.
+ * @param end Indeks za ostatnim zbiorem przedziału.
+ * @param order Długości posortowane rosnąco.
+ * @param lenCount Liczba długości.
+ * @param[out] out Tablica wyników.
+ */
+static void
+countBatchRange(const struct CountIndex *idx, struct SetQuery *q,
+                size_t begin, size_t end, const struct LenQuery *order,
+                size_t lenCount, size_t *out)
+{
+	/* Wartości horner dla kolejnych długości d powstają schematem Hornera
+	 * w jednym przejściu po licznikach. Wynikiem dla długości n jest
+	 * wartość dla d = n, a dla n większych od długości D najdłuższego
+	 * słowa - wartość dla D razy |S|^(n - D). */
+	size_t next = 0;
+	for (size_t d = 0; d < idx->depth; ++d) {
+		const struct CountLevel *level = &idx->levels[d];
+		for (size_t i = begin; i < end; ++i) {
+			q[i].horner *= q[i].base;
+			for (size_t t = 0; t < level->size; ++t) {
+				if (subset(level->terms[t].mask, q[i].mask))
+					q[i].horner += level->terms[t].count;
+			}
+		}
+		for (; next < lenCount && order[next].len == d; ++next) {
+			for (size_t i = begin; i < end; ++i)
+				out[i * lenCount + order[next].idx] = q[i].horner;
+		}
+	}
+	size_t top = idx->depth ? idx->depth - 1 : 0;
+	for (; next < lenCount; ++next) {
+		for (size_t i = begin; i < end; ++i) {
+			out[i * lenCount + order[next].idx] =
+				q[i].horner * power(q[i].base, order[next].len - top);
+		}
+	}
+}
+
+/**
+ * @brief Wykonuje jedno zadanie zlecenia. Funkcja typu PoolTask.
+ *
+ * @param ctx Zlecenie (struct BatchJob).
+ * @param idx Indeks zadania.
+ */
+static void
+batchTask(void *ctx, size_t idx)
+{
+	struct BatchJob *job = ctx;
+	size_t begin = idx * job->chunk;
+	size_t end = begin + job->chunk < job->setCount
+	             ? begin + job->chunk : job->setCount;
+	countBatchRange(job->idx, job->q, begin, end, job->order, job->lenCount,
+	                job->out);
+}
+
+bool
+phfwdNonTrivialCountBatch(struct PhoneForward *pf, char const *const *sets,
+                          size_t setCount, size_t const *lens, size_t lenCount,
+                          size_t *out)
+{
+	if (!pf || (setCount && !sets) || (lenCount && !lens)
+	    || (setCount && lenCount && !out))
+		return false;
+	struct LenQuery *order = malloc((lenCount ? lenCount : 1)
+	                                * sizeof(struct LenQuery));
+	struct SetQuery *q = malloc((setCount ? setCount : 1)
+	                            * sizeof(struct SetQuery));
+	if (!order || !q) {
+		free(order);
+		free(q);
+		return false;
+	}
+	for (size_t j = 0; j < lenCount; ++j)
+		order[j] = (struct LenQuery){lens[j], j};
+	qsort(order, lenCount, sizeof(struct LenQuery), lenOrder);
+	for (size_t i = 0; i < setCount; ++i) {
+		q[i].mask = sets[i] ? charset(sets[i]) : 0;
+		q[i].base = charset_size(q[i].mask);
+		q[i].horner = 0;
+	}
+
+	const struct CountIndex *idx = &pf->counts;
+	size_t terms = 0;
+	for (size_t d = 0; d < idx->depth; ++d)
+		terms += idx->levels[d].size;
+	if (pf->pool && setCount > 1 && setCount * terms >= PARALLEL_MIN_TERMS) {
+		size_t tasks = (size_t)poolSize(pf->pool) * TASKS_PER_THREAD;
+		size_t chunk = (setCount + tasks - 1) / tasks;
+		struct BatchJob job = {idx, q, setCount, chunk, order, lenCount, out};
+		poolRun(pf->pool, batchTask, &job, (setCount + chunk - 1) / chunk);
+	} else {
+		countBatchRange(idx, q, 0, setCount, order, lenCount, out);
+	}
+	free(order);
+	free(q);
+	return true;
+}
+
 size_t
 phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len)
 {
 	if (!pf || !set || !len) return 0;
-	unsigned char_set = charset(set);
-	return nonTrivialCountRec(pf->to, char_set, charset_size(char_set), len);
+	unsigned mask = charset(set);
+	size_t base = charset_size(mask);
+	const struct CountIndex *idx = &pf->counts;
+	if (idx->depth == 0) return 0;
+	size_t depth = idx->depth - 1 < len ? idx->depth - 1 : len;
+
+	/* Długości są przeglądane malejąco, więc kolejne potęgi powstają przez
+	 * mnożenie poprzedniej przez podstawę. */
+	size_t ret = 0;
+	size_t pw = power(base, len - depth);
+	for (size_t d = depth + 1; d-- > 0; pw *= base) {
+		const struct CountLevel *level = &idx->levels[d];
+		for (size_t i = 0; i < level->size; ++i) {
+			if (subset(level->terms[i].mask, mask))
+				ret += level->terms[i].count * pw;
+		}
+	}
+	return ret;
+}
+
+struct PhoneForwardSnapshot *
+phfwdSnapshot(struct PhoneForward *pf)
+{
+	if (!pf) return NULL;
+	struct PhoneForwardSnapshot *new =
+		malloc(sizeof(struct PhoneForwardSnapshot));
+	if (!new) return NULL;
+	pthread_rwlock_wrlock(&pf->lock);
+	if (pf->snapshots == pf->snapshotCap) {
+		size_t cap = pf->snapshotCap ? 2 * pf->snapshotCap : 4;
+		struct PhoneForwardSnapshot **list =
+			realloc(pf->snapshotList, cap * sizeof(*list));
+		if (!list) {
+			pthread_rwlock_unlock(&pf->lock);
+			free(new);
+			return NULL;
+		}
+		pf->snapshotList = list;
+		pf->snapshotCap = cap;
+	}
+	new->pf = pf;
+	new->version = pf->version;
+	/* Wersje struktury rosną, więc tablica pozostaje posortowana. */
+	pf->snapshotList[pf->snapshots++] = new;
+	pthread_rwlock_unlock(&pf->lock);
+	return new;
+}
+
+void
+phfwdSnapshotDelete(struct PhoneForwardSnapshot *snap)
+{
+	if (!snap) return;
+	struct PhoneForward *pf = snap->pf;
+	if (!pf) {
+		free(snap);
+		return;
+	}
+	pthread_rwlock_wrlock(&pf->lock);
+	struct PhoneForwardSnapshot **list = pf->snapshotList;
+	size_t i = 0;
+	while (list[i] != snap)
+		++i;
+	memmove(list + i, list + i + 1,
+	        (--pf->snapshots - i) * sizeof(*list));
+	if (pf->snapshots == 0)
+		historyClear(&pf->history);
+	else if (i == 0 && list[0]->version != snap->version)
+		historyTrim(&pf->history, list[0]->version);
+	pthread_rwlock_unlock(&pf->lock);
+	free(snap);
+}
+
+/**
+ * @brief Wyznacza przekierowanie numeru w migawce. Wywołujący trzyma blokadę
+ * struktury do odczytu.
+ *
+ * @param snap Migawka.
+ * @param num Numer.
+ *
+ * @return Wynik jak dla phfwdSnapshotGet().
+ */
+static const struct PhoneNumbers *
+snapshotGet(const struct PhoneForwardSnapshot *snap, char const *num)
+{
+	struct PhoneForward *pf = snap->pf;
+	if (!isNumber(num) || pf->version == snap->version)
+		return phfwdGet(pf, num);
+
+	struct Key k;
+	if (!makeKey(&k, num)) return NULL;
+	const char **current = calloc(k.len + 1, sizeof(char*));
+	if (!current) {
+		freeKey(&k);
+		return NULL;
+	}
+	rt *arg = pf->from;
+	size_t pos = 0;
+	while (1) {
+		if (arg->fwd)
+			current[pos] = arg->fwd->fullWord;
+		if (pos == k.len) break;
+		rt *child = selectChild(arg, digitAt(k.digits, pos));
+		if (!child || matchLabel(child, &k, pos) < child->labelLength)
+			break;
+		pos += child->labelLength;
+		arg = child;
+	}
+
+	const char *prefix = "";
+	const char *suffix = num;
+	for (size_t len = k.len + 1; len-- > 0; ) {
+		const char *old = current[len];
+		historyFind(&pf->history, num, len, snap->version, &old);
+		if (old) {
+			prefix = old;
+			suffix = num + len;
+			break;
+		}
+	}
+	free(current);
+	freeKey(&k);
+	return joinNumber(prefix, suffix);
+}
+
+/**
+ * @brief Wyznacza przekierowania na numer w migawce. Wywołujący trzyma
+ * blokadę struktury do odczytu.
+ *
+ * @param snap Migawka.
+ * @param num Numer.
+ *
+ * @return Wynik jak dla phfwdSnapshotReverse().
+ */
+static const struct PhoneNumbers *
+snapshotReverse(const struct PhoneForwardSnapshot *snap, char const *num)
+{
+	if (!isNumber(num) || snap->pf->version == snap->version)
+		return phfwdReverse(snap->pf, num);
+
+	struct Key k;
+	if (!makeKey(&k, num)) return NULL;
+	struct RevPair *vec;
+	size_t size;
+	struct PhoneNumbers *new = NULL;
+	if (snapshotPairs(snap, &k, &vec, &size))
+		new = pairsToNumbers(vec, size);
+	free(vec);
+	freeKey(&k);
+	return new;
+}
+
+const struct PhoneNumbers *
+phfwdSnapshotGet(const struct PhoneForwardSnapshot *snap, char const *num)
+{
+	if (!snap || !snap->pf) return NULL;
+	pthread_rwlock_rdlock(&snap->pf->lock);
+	const struct PhoneNumbers *ret = snapshotGet(snap, num);
+	pthread_rwlock_unlock(&snap->pf->lock);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdSnapshotReverse(const struct PhoneForwardSnapshot *snap, char const *num)
+{
+	if (!snap || !snap->pf) return NULL;
+	pthread_rwlock_rdlock(&snap->pf->lock);
+	const struct PhoneNumbers *ret = snapshotReverse(snap, num);
+	pthread_rwlock_unlock(&snap->pf->lock);
+	return ret;
+}
+
+bool
+phfwdAddBulk(struct PhoneForward *pf, char const *const *pairs, size_t n)
+{
+	if (!pf || (n && !pairs)) return false;
+	bool ret = true;
+	if (childCount(pf->from) || childCount(pf->to) || pf->snapshots) {
+		for (size_t i = 0; i < n; ++i)
+			ret &= phfwdAdd(pf, pairs[2 * i], pairs[2 * i + 1]);
+		return ret;
+	}
+
+	struct BulkRule *rules = malloc((n ? n : 1) * sizeof(struct BulkRule));
+	if (!rules) return false;
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const char *num1 = pairs[2 * i], *num2 = pairs[2 * i + 1];
+		if (!isNumber(num1) || !isNumber(num2) || !strcmp(num1, num2)) {
+			ret = false;
+			continue;
+		}
+		rules[count++] = (struct BulkRule){{num1, strlen(num1), NULL},
+		                                   {num2, strlen(num2), NULL}};
+	}
+	if (pf->pool && count >= PARALLEL_MIN_RULES)
+		ret &= loadBulkParallel(pf, rules, count);
+	else
+		ret &= loadBulk(pf, rules, count);
+	free(rules);
+	return ret;
+}
+
+bool
+phfwdSave(struct PhoneForward *pf, int fd)
+{
+	if (!pf) return false;
+	size_t all[2] = {0, 0}, nodes[2] = {0, 0}, words[2] = {0, 0};
+	size_t bytes[2] = {0, 0}, unused = 0;
+	measureTree(pf->from, &all[0], &unused, &unused);
+	measureTree(pf->to, &all[1], &unused, &unused);
+	size_t *skip = malloc((all[0] + all[1]) * sizeof(size_t));
+	if (!skip) return false;
+	markTree(pf->from, skip, &nodes[0], &bytes[0], &words[0]);
+	markTree(pf->to, skip + all[0], &nodes[1], &bytes[1], &words[1]);
+	if (nodes[0] > UINT32_MAX || nodes[1] > UINT32_MAX) {
+		free(skip);
+		return false;
+	}
+	size_t records = nodes[0] + nodes[1];
+	size_t size = sizeof(struct SaveHeader)
+	              + records * sizeof(struct SaveNode)
+	              + words[0] * sizeof(struct SaveLink) + bytes[0] + bytes[1];
+	size_t mask = 1;
+	while (mask < 2 * words[1])
+		mask *= 2;
+	--mask;
+	uint8_t *buf = malloc(size);
+	struct NodeIndex *targets = calloc(mask + 1, sizeof(struct NodeIndex));
+	bool ret = buf && targets;
+	if (ret) {
+		struct SaveHeader head = {SAVE_MAGIC, SAVE_VERSION, SAVE_BYTE_ORDER, 0,
+		                          {nodes[0], nodes[1]}, words[0],
+		                          bytes[0] + bytes[1]};
+		memcpy(buf, &head, sizeof(head));
+		struct SaveNode *records0 = (struct SaveNode*)(buf + sizeof(head));
+		uint8_t *labels0 = buf + size - bytes[0] - bytes[1];
+		struct SaveCursor out = {records0 + nodes[0], labels0 + bytes[0],
+		                         NULL, skip + all[0], targets, mask, 0};
+		saveTree(pf->to, &out);
+		out = (struct SaveCursor){records0, labels0,
+		                          (struct SaveLink*)(records0 + records),
+		                          skip, targets, mask, 0};
+		saveTree(pf->from, &out);
+		ret = writeAll(fd, buf, size);
+	}
+	free(buf);
+	free(targets);
+	free(skip);
+	return ret;
+}
+
+struct PhoneForward *
+phfwdLoad(int fd)
+{
+	size_t size;
+	uint8_t *buf = readAll(fd, &size);
+	if (!buf) return NULL;
+	struct PhoneForward *ret = loadImage(buf, size);
+	free(buf);
+	return ret;
+}
+
+bool
+phfwdFreeze(struct PhoneForward *pf, int fd)
+{
+	if (!pf) return false;
+	struct FrozenHeader head = {FROZEN_MAGIC, FROZEN_VERSION, SAVE_BYTE_ORDER,
+	                            0, {0, 0}, 0, pf->counts.depth, 0, 0, 0};
+	size_t targets = 0;
+	measureFrozen(pf->from, &head, 0, &targets);
+	measureFrozen(pf->to, &head, 1, &targets);
+	for (size_t d = 0; d < pf->counts.depth; ++d) {
+		const struct CountLevel *level = &pf->counts.levels[d];
+		for (size_t i = 0; i < level->size; ++i)
+			head.terms += level->terms[i].count > 0;
+	}
+	struct FrozenLayout layout;
+	if (!frozenLayout(&head, &layout)) return false;
+
+	size_t mask = 1;
+	while (mask < 2 * targets)
+		mask *= 2;
+	--mask;
+	uint8_t *buf = calloc(layout.size, 1);
+	struct NodeIndex *index = calloc(mask + 1, sizeof(struct NodeIndex));
+	bool ret = buf && index;
+	if (ret) {
+		memcpy(buf, &head, sizeof(head));
+		struct FreezeCursor cur = {(char*)buf + layout.labels, 0,
+		                           (char*)buf + layout.words, 0,
+		                           (uint32_t*)(buf + layout.sources), 0,
+		                           index, mask};
+		ret = freezeTree(pf->to, head.nodes[1],
+		                 (struct FrozenNode*)(buf + layout.nodes[1]), &cur)
+		      && freezeTree(pf->from, head.nodes[0],
+		                    (struct FrozenNode*)(buf + layout.nodes[0]), &cur);
+	}
+	if (ret) {
+		uint64_t *levels = (uint64_t*)(buf + layout.levels);
+		struct FrozenTerm *terms = (struct FrozenTerm*)(buf + layout.terms);
+		size_t count = 0;
+		for (size_t d = 0; d < head.levels; ++d) {
+			const struct CountLevel *level = &pf->counts.levels[d];
+			levels[d] = count;
+			for (size_t i = 0; i < level->size; ++i) {
+				const struct CountTerm *term = &level->terms[i];
+				if (term->count)
+					terms[count++] = (struct FrozenTerm){
+						term->count, term->mask, 0};
+			}
+		}
+		levels[head.levels] = count;
+		ret = writeAll(fd, buf, layout.size);
+	}
+	free(buf);
+	free(index);
+	return ret;
+}
+
+struct PhoneForwardFrozen *
+phfwdFrozenOpen(const void *data, size_t size)
+{
+	if (!data) return NULL;
+	return frozenOpen(data, size, false);
+}
+
+struct PhoneForwardFrozen *
+phfwdFrozenMap(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size <= 0
+	    || (uintmax_t)st.st_size > SIZE_MAX)
+		return NULL;
+	size_t size = st.st_size;
+	void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) return NULL;
+	struct PhoneForwardFrozen *ret = frozenOpen(data, size, true);
+	if (!ret)
+		munmap(data, size);
+	return ret;
+}
+
+void
+phfwdFrozenDelete(struct PhoneForwardFrozen *pf)
+{
+	if (!pf) return;
+	if (pf->mapped)
+		munmap((void*)pf->data, pf->size);
+	free(pf);
+}
+
+const struct PhoneNumbers *
+phfwdFrozenGet(const struct PhoneForwardFrozen *pf, char const *num)
+{
+	if (!pf) return NULL;
+	if (!isNumber(num)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	size_t len = strlen(num), pos = 0, matched = 0;
+	const char *prefix = "";
+	const struct FrozenNode *node = pf->nodes[0];
+	while (node) {
+		if (node->dataCount) {
+			prefix = pf->words + node->data;
+			matched = pos;
+		}
+		if (pos == len) break;
+		node = frozenChild(pf->nodes[0], pf->labels, node, num + pos,
+		                   len - pos);
+		if (node)
+			pos += node->labelLength;
+	}
+	return joinNumber(prefix, num + matched);
+}
+
+const struct PhoneNumbers *
+phfwdFrozenReverse(const struct PhoneForwardFrozen *pf, char const *num)
+{
+	if (!pf) return NULL;
+	if (!isNumber(num)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	size_t len = strlen(num), pos = 0, size = 1;
+	const struct FrozenNode *node = pf->nodes[1];
+	while (node) {
+		size += node->dataCount;
+		if (pos == len) break;
+		node = frozenChild(pf->nodes[1], pf->labels, node, num + pos,
+		                   len - pos);
+		if (node)
+			pos += node->labelLength;
+	}
+	struct RevPair *vec = malloc(size * sizeof(struct RevPair));
+	if (!vec) return NULL;
+	vec[0] = (struct RevPair){"", num};
+	size = 1;
+	pos = 0;
+	node = pf->nodes[1];
+	while (node) {
+		for (size_t i = 0; i < node->dataCount; ++i) {
+			vec[size++] = (struct RevPair){
+				pf->words + pf->sources[node->data + i], num + pos};
+		}
+		if (pos == len) break;
+		node = frozenChild(pf->nodes[1], pf->labels, node, num + pos,
+		                   len - pos);
+		if (node)
+			pos += node->labelLength;
+	}
+	struct PhoneNumbers *ret = pairsToNumbers(vec, size);
+	free(vec);
+	return ret;
+}
+
+size_t
+phfwdFrozenNonTrivialCount(const struct PhoneForwardFrozen *pf,
+                           char const *set, size_t len)
+{
+	if (!pf || !set || !len || !pf->levelCount) return 0;
+	unsigned mask = charset(set);
+	size_t base = charset_size(mask);
+	size_t depth = pf->levelCount - 1 < len ? pf->levelCount - 1 : len;
+
+	size_t ret = 0;
+	size_t pw = power(base, len - depth);
+	for (size_t d = depth + 1; d-- > 0; pw *= base) {
+		for (size_t i = pf->levels[d]; i < pf->levels[d + 1]; ++i) {
+			if (subset(pf->terms[i].mask, mask))
+				ret += pf->terms[i].count * pw;
+		}
+	}
+	return ret;
+}
+
+struct PhoneForwardSuccinct *
+phfwdSuccinctNew(struct PhoneForward *pf)
+{
+	if (!pf) return NULL;
+	struct PhoneForwardSuccinct *new = calloc(1,
+	                                          sizeof(struct PhoneForwardSuccinct));
+	if (!new) return NULL;
+	size_t counts[2];
+	const rt **queues[2] = {succinctQueue(pf->from, &counts[0]),
+	                        succinctQueue(pf->to, &counts[1])};
+	size_t targets = 0, sources = 0;
+	for (size_t i = 0; queues[1] && i < counts[1]; ++i) {
+		if (queues[1][i]->sources) {
+			++targets;
+			sources += queues[1][i]->sources->count;
+		}
+	}
+	size_t mask = 1;
+	while (mask < 2 * (targets + sources))
+		mask *= 2;
+	--mask;
+	struct NodeIndex *index = NULL;
+	bool ret = queues[0] && queues[1] && counts[0] <= UINT32_MAX
+	           && counts[1] <= UINT32_MAX && sources < UINT32_MAX
+	           && (index = calloc(mask + 1, sizeof(struct NodeIndex)))
+	           && succinctTree(&new->trees[1], queues[1], counts[1], 1, index,
+	                           mask)
+	           && succinctTree(&new->trees[0], queues[0], counts[0], 0, index,
+	                           mask)
+	           && (new->targets = malloc((sources + 1) * sizeof(uint32_t)))
+	           && (new->sources = malloc((sources + 1) * sizeof(uint32_t)))
+	           && (new->firstSource = malloc((targets + 1)
+	                                         * sizeof(uint32_t)));
+	if (ret) {
+		size_t pos = 0;
+		for (size_t i = 0; i < counts[0]; ++i) {
+			if (queues[0][i]->fwd)
+				new->targets[pos++] = findIndex(index, mask,
+				                                queues[0][i]->fwd)->idx;
+		}
+		size_t target = 0;
+		pos = 0;
+		for (size_t i = 0; i < counts[1]; ++i) {
+			const struct Sources *vec = queues[1][i]->sources;
+			if (!vec) continue;
+			new->firstSource[target++] = pos;
+			for (size_t j = 0; j < vec->count; ++j)
+				new->sources[pos++] = findIndex(index, mask,
+				                                vec->item[j].node)->idx;
+		}
+		new->firstSource[target] = pos;
+	}
+	free(queues[0]);
+	free(queues[1]);
+	free(index);
+	if (!ret) {
+		phfwdSuccinctDelete(new);
+		return NULL;
+	}
+	return new;
+}
+
+void
+phfwdSuccinctDelete(struct PhoneForwardSuccinct *pf)
+{
+	if (!pf) return;
+	succinctFree(&pf->trees[0]);
+	succinctFree(&pf->trees[1]);
+	free(pf->targets);
+	free(pf->sources);
+	free(pf->firstSource);
+	free(pf);
+}
+
+size_t
+phfwdSuccinctSize(const struct PhoneForwardSuccinct *pf)
+{
+	if (!pf) return 0;
+	size_t ret = sizeof(struct PhoneForwardSuccinct);
+	for (unsigned t = 0; t < 2; ++t) {
+		const struct SuccinctTree *tree = &pf->trees[t];
+		ret += bitsBytes(&tree->louds) + bitsBytes(&tree->starts)
+		       + bitsBytes(&tree->marked) + digitsSize(tree->digits + 1);
+	}
+	size_t targets = pf->trees[1].marked.ones;
+	size_t sources = pf->firstSource[targets];
+	return ret + (2 * sources + targets + 3) * sizeof(uint32_t);
+}
+
+const struct PhoneNumbers *
+phfwdSuccinctGet(const struct PhoneForwardSuccinct *pf, char const *num)
+{
+	if (!pf) return NULL;
+	if (!isNumber(num)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	struct Key key;
+	if (!makeKey(&key, num)) return NULL;
+	const struct SuccinctTree *from = &pf->trees[0];
+	size_t node = 0, pos = 0, best = 0, matched = 0;
+	do {
+		if (bitsGet(&from->marked, node)) {
+			best = node;
+			matched = pos;
+		}
+	} while (pos < key.len && (node = succinctChild(from, node, &key, &pos)));
+	freeKey(&key);
+	if (!best) return joinNumber("", num);
+
+	const struct SuccinctTree *to = &pf->trees[1];
+	char *buf = malloc(to->maxLength + 1);
+	if (!buf) return NULL;
+	struct PhoneNumbers *ret = joinNumber(
+		succinctWord(to, pf->targets[bitsRank1(&from->marked, best)], buf),
+		num + matched);
+	free(buf);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdSuccinctReverse(const struct PhoneForwardSuccinct *pf, char const *num)
+{
+	if (!pf) return NULL;
+	if (!isNumber(num)) {
+		struct PhoneNumbers *new = malloc(sizeof(struct PhoneNumbers));
+		if (!new) return NULL;
+		new->size = 0;
+		return new;
+	}
+
+	struct Key key;
+	if (!makeKey(&key, num)) return NULL;
+	const struct SuccinctTree *to = &pf->trees[1];
+	const struct SuccinctTree *from = &pf->trees[0];
+	size_t stride = from->maxLength + 1;
+	struct SuccinctStep *path = malloc((key.len + 1)
+	                                   * sizeof(struct SuccinctStep));
+	struct RevPair *vec = NULL;
+	char *words = NULL;
+	struct PhoneNumbers *ret = NULL;
+	if (!path) goto free_buffers;
+	size_t node = 0, pos = 0, depth = 0, size = 1;
+	do {
+		if (!bitsGet(&to->marked, node)) continue;
+		size_t rank = bitsRank1(&to->marked, node);
+		path[depth++] = (struct SuccinctStep){rank, pos};
+		size += pf->firstSource[rank + 1] - pf->firstSource[rank];
+	} while (pos < key.len && (node = succinctChild(to, node, &key, &pos)));
+
+	vec = malloc(size * sizeof(struct RevPair));
+	words = malloc(size * stride);
+	if (!vec || !words) goto free_buffers;
+	vec[0] = (struct RevPair){"", num};
+	size = 1;
+	for (size_t d = 0; d < depth; ++d) {
+		size_t rank = path[d].rank;
+		for (size_t i = pf->firstSource[rank]; i < pf->firstSource[rank + 1];
+		     ++i) {
+			vec[size] = (struct RevPair){
+				succinctWord(from, pf->sources[i], words + size * stride),
+				num + path[d].pos};
+			++size;
+		}
+	}
+	ret = pairsToNumbers(vec, size);
+
+free_buffers:
+	freeKey(&key);
+	free(path);
+	free(vec);
+	free(words);
+	return ret;
 }
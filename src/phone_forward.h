@@ -23,6 +23,26 @@ struct PhoneForward;
  */
 struct PhoneNumbers;
 
+/**
+ * Iterator po wynikach wyszukiwania przekierowań na dany numer.
+ */
+struct PhoneReverseIter;
+
+/**
+ * Migawka struktury przechowującej przekierowania.
+ */
+struct PhoneForwardSnapshot;
+
+/**
+ * Niezmienna struktura przechowująca przekierowania, zapisana bez wskaźników.
+ */
+struct PhoneForwardFrozen;
+
+/**
+ * Zwięzła, niezmienna kopia struktury przechowującej przekierowania.
+ */
+struct PhoneForwardSuccinct;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -32,11 +52,65 @@ struct PhoneForward * phfwdNew(void);
 
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pf. Nic nie robi, jeśli wskaźnik ten ma
- * wartość NULL.
+ * wartość NULL. Istniejące migawki struktury zostają unieważnione i nadal
+ * trzeba je usunąć za pomocą funkcji @ref phfwdSnapshotDelete.
  * @param[in] pf – wskaźnik na usuwaną strukturę.
  */
 void phfwdDelete(struct PhoneForward *pf);
 
+/** @brief Tworzy kopię struktury.
+ * Tworzy nową strukturę zawierającą te same przekierowania co @p pf. Kopia
+ * nie dzieli pamięci z oryginałem ani nie przejmuje jego puli wątków.
+ * @param[in] pf – wskaźnik na kopiowaną strukturę.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p pf ma
+ *         wartość NULL lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForward * phfwdCopy(struct PhoneForward *pf);
+
+/** @brief Zapisuje strukturę do pliku.
+ * Zapisuje przekierowania w zwartym formacie binarnym, który
+ * @ref phfwdLoad wczytuje bez analizowania numerów. Format ma numer wersji
+ * i jest zależny od kolejności bajtów komputera. Migawki nie są zapisywane.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów;
+ * @param[in] fd – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli struktura została zapisana. Wartość
+ *         @p false, jeśli wskaźnik @p pf ma wartość NULL, nie udało się
+ *         zaalokować pamięci lub zapis się nie powiódł; wtedy do pliku mogła
+ *         trafić część danych.
+ */
+bool phfwdSave(struct PhoneForward *pf, int fd);
+
+/** @brief Wczytuje strukturę z pliku.
+ * Tworzy nową strukturę z przekierowaniami zapisanymi przez @ref phfwdSave,
+ * wczytując plik do końca.
+ * @param[in] fd – deskryptor pliku otwartego do odczytu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy odczyt się nie
+ *         powiódł, plik nie zawiera poprawnie zapisanej struktury w tej
+ *         samej wersji formatu lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForward * phfwdLoad(int fd);
+
+/** @brief Ustala liczbę wątków używanych przez zapytania o liczbę numerów.
+ * Dołącza do struktury pulę wątków, między które
+ * @ref phfwdNonTrivialCountPattern dzieli przeszukiwanie poddrzew,
+ * @ref phfwdNonTrivialCountBatch - obliczenia dla zbiorów cyfr, a
+ * @ref phfwdAddBulk - budowę poddrzew numerów zaczynających się różnymi
+ * cyframi. Małe bazy i zapytania są nadal obsługiwane przez jeden wątek.
+ * Zastępuje poprzednio dołączoną pulę. Struktura nie może być w tym czasie
+ * używana przez inne wątki.
+ *
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] threads – łączna liczba wątków wykonujących obliczenia, wliczając
+ *                      wątek wywołujący; wartości 0 i 1 usuwają pulę.
+ *
+ * @return Wartość @p true, jeśli liczba wątków została ustalona. Wartość
+ *         @p false, jeśli wskaźnik @p pf ma wartość NULL lub nie udało się
+ *         utworzyć wątków; wtedy struktura pozostaje bez zmian.
+ */
+bool phfwdSetThreads(struct PhoneForward *pf, unsigned threads);
+
 /** @brief Dodaje przekierowanie.
  * Dodaje przekierowanie wszystkich numerów mających prefiks @p num1, na numery,
  * w których ten prefiks zamieniono odpowiednio na prefiks @p num2. Każdy numer
@@ -54,6 +128,27 @@ void phfwdDelete(struct PhoneForward *pf);
  */
 bool phfwdAdd(struct PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje wiele przekierowań naraz.
+ * Daje ten sam wynik co wywołanie @ref phfwdAdd kolejno dla par
+ * (@p pairs[2i], @p pairs[2i + 1]). Jeśli struktura nie zawiera żadnych
+ * przekierowań ani migawek, sortuje pary i buduje oba drzewa od dołu w jednym
+ * przejściu, co jest szybsze niż dodawanie par po kolei. Jeśli do struktury
+ * dołączono pulę wątków (@ref phfwdSetThreads), a par jest dużo, poddrzewa
+ * numerów zaczynających się różnymi cyframi są budowane równolegle.
+ * Niepoprawne pary są pomijane.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] pairs – tablica 2 * @p n napisów: kolejno prefiks numerów
+ *                    przekierowywanych i prefiks numerów, na które jest
+ *                    wykonywane przekierowanie;
+ * @param[in] n     – liczba par.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli któraś para jest niepoprawna lub nie udało
+ *         się zaalokować pamięci. W tym drugim przypadku pusta struktura
+ *         pozostaje pusta.
+ */
+bool phfwdAddBulk(struct PhoneForward *pf, char const *const *pairs, size_t n);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
@@ -77,6 +172,62 @@ void phfwdRemove(struct PhoneForward *pf, char const *num);
  */
 struct PhoneNumbers const * phfwdGet(struct PhoneForward *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru do bufora podanego przez wywołującego.
+ * Działa jak @ref phfwdGet, ale zamiast alokować strukturę @p PhoneNumbers,
+ * zapisuje wynikowy numer zakończony znakiem '\0' do bufora @p buf, o ile
+ * mieści się on w @p cap bajtach. W przeciwnym razie zawartość bufora jest
+ * nieokreślona. Jeśli podany napis nie reprezentuje numeru lub wskaźnik @p pf
+ * ma wartość NULL, wynikiem jest pusty napis. Nie alokuje pamięci, chyba że
+ * numer jest dłuższy niż 64 cyfry.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer;
+ * @param[out] buf – bufor na wynik; może mieć wartość NULL, jeśli @p cap jest
+ *                   równe zeru;
+ * @param[in] cap  – rozmiar bufora w bajtach.
+ * @return Długość wynikowego numeru bez kończącego znaku '\0'. Wynik jest
+ *         zapisany w buforze wtedy i tylko wtedy, gdy jest mniejszy niż
+ *         @p cap. Wartość SIZE_MAX, gdy nie udało się zaalokować pamięci.
+ */
+size_t phfwdGetInto(struct PhoneForward *pf, char const *num, char *buf,
+                    size_t cap);
+
+/** @brief Wyznacza przekierowania wielu numerów naraz.
+ * Dla każdego numeru z tablicy @p nums wyznacza ten sam wynik co
+ * @ref phfwdGet. Zapytania są rozwiązywane w porządku leksykograficznym
+ * numerów (tablica posortowana nie jest sortowana ponownie), a schodzenie
+ * w drzewie dla kolejnego numeru zaczyna się od miejsca, w którym rozchodzi
+ * się on z poprzednim. Wyniki są umieszczane w jednym bloku pamięci. Alokuje
+ * strukturę @p PhoneNumbers, która musi być zwolniona za pomocą funkcji
+ * @ref phnumDelete.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] n    – długość tablicy @p nums.
+ * @return Wskaźnik na strukturę przechowującą ciąg @p n numerów, w którym
+ *         numer o indeksie i jest przekierowaniem numeru @p nums[i]. Jeśli
+ *         @p nums[i] nie reprezentuje numeru, @ref phnumGet zwraca dla
+ *         indeksu i wartość NULL. Wartość NULL, gdy wskaźnik @p pf ma wartość
+ *         NULL lub nie udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdGetBatch(struct PhoneForward *pf,
+                                          char const *const *nums, size_t n);
+
+/** @brief Wyznacza przekierowania wielu numerów naraz, przeplatając
+ * wyszukiwania.
+ * Wynik jest taki sam jak dla @ref phfwdGetBatch, ale numery nie są
+ * sortowane. Do 16 wyszukiwań jest prowadzonych jednocześnie: każde z nich
+ * schodzi w drzewie o jeden poziom, zlecając wcześniej sprowadzenie
+ * potrzebnej pamięci, po czym ustępuje miejsca kolejnemu. Dzięki temu czasy
+ * oczekiwania na pamięć przy dużych strukturach nakładają się na siebie.
+ * Alokuje strukturę @p PhoneNumbers, która musi być zwolniona za pomocą
+ * funkcji @ref phnumDelete.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] n    – długość tablicy @p nums.
+ * @return Jak dla @ref phfwdGetBatch.
+ */
+struct PhoneNumbers const * phfwdGetMany(struct PhoneForward *pf,
+                                         char const *const *nums, size_t n);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza wszystkie przekierowania na podany numer. Wynikowy ciąg zawiera też
  * dany numer. Wynikowe numery są posortowane leksykograficznie i nie mogą się
@@ -90,6 +241,82 @@ struct PhoneNumbers const * phfwdGet(struct PhoneForward *pf, char const *num);
  */
 struct PhoneNumbers const * phfwdReverse(struct PhoneForward *pf, char const *num);
 
+/** @brief Wyznacza liczbę przekierowań na dany numer.
+ * Wynik jest równy rozmiarowi ciągu zwracanego przez @ref phfwdReverse, ale
+ * numery nie są tworzone w pamięci.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba różnych numerów przekierowanych na @p num, wliczając sam
+ *         numer. Wartość 0, jeśli wskaźnik @p pf ma wartość NULL, podany
+ *         napis nie reprezentuje numeru lub nie udało się zaalokować pamięci.
+ */
+size_t phfwdReverseCount(struct PhoneForward *pf, char const *num);
+
+/** @brief Wyznacza fragment wyniku wyszukiwania przekierowań na dany numer.
+ * Wyznacza co najwyżej @p k pierwszych numerów z wyniku @ref phfwdReverse,
+ * które są leksykograficznie większe od @p after. Pozwala to przeglądać
+ * wynik stronami: kolejna strona zaczyna się za ostatnim numerem poprzedniej.
+ * Numery mniejsze od @p after są pomijane bez przeglądania, a wyszukiwanie
+ * kończy się po znalezieniu @p k numerów. Alokuje strukturę @p PhoneNumbers,
+ * która musi być zwolniona za pomocą funkcji @ref phnumDelete.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] num   – wskaźnik na napis reprezentujący numer;
+ * @param[in] k     – maksymalna liczba wyznaczanych numerów;
+ * @param[in] after – wskaźnik na napis ograniczający wynik od dołu lub NULL,
+ *                    jeśli wynik ma się zaczynać od najmniejszego numeru.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         wskaźnik @p pf ma wartość NULL lub nie udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdReverseLimit(struct PhoneForward *pf,
+                                              char const *num, size_t k,
+                                              char const *after);
+
+/** @brief Tworzy iterator po przekierowaniach na dany numer.
+ * Iterator zwraca kolejno te same numery, które zawierałby wynik
+ * @ref phfwdReverse, w tej samej kolejności, ale wyznacza je dopiero na
+ * żądanie. Zajmuje pamięć zależną od długości numeru i liczby przekierowań,
+ * których numery źródłowe są swoimi prefiksami, a nie od liczby wyników.
+ * Iterator przestaje być ważny po zmianie struktury @p pf. Musi być zwolniony
+ * za pomocą funkcji @ref phfwdReverseIterDelete.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na iterator lub NULL, gdy wskaźnik @p pf ma wartość NULL
+ *         lub nie udało się zaalokować pamięci. Jeśli podany napis nie
+ *         reprezentuje numeru, iterator nie zwraca żadnego numeru.
+ */
+struct PhoneReverseIter * phfwdReverseIterNew(struct PhoneForward *pf,
+                                              char const *num);
+
+/** @brief Udostępnia następny numer z iteratora.
+ * @param[in] it – wskaźnik na iterator.
+ * Jeśli nie udało się zaalokować pamięci na zwracany numer, ten sam numer
+ * jest zwracany przy następnym wywołaniu. Jeśli zawiodła alokacja pamięci
+ * na stan iteratora, iterator nie zwraca już żadnych numerów.
+ * @param[in] it – wskaźnik na iterator.
+ * @return Wskaźnik na napis reprezentujący numer, ważny do następnego
+ *         wywołania funkcji dla tego iteratora. Wartość NULL, jeśli numery
+ *         się skończyły, wskaźnik @p it ma wartość NULL lub nie udało się
+ *         zaalokować pamięci; te przypadki rozróżnia funkcja
+ *         @ref phfwdReverseIterFailed.
+ */
+char const * phfwdReverseIterNext(struct PhoneReverseIter *it);
+
+/** @brief Sprawdza, czy iterator zawiódł.
+ * @param[in] it – wskaźnik na iterator.
+ * @return Wartość @p true, jeśli ostatnie wywołanie funkcji
+ *         @ref phfwdReverseIterNext dla tego iteratora zwróciło NULL
+ *         z powodu błędu alokacji pamięci, a @p false w przeciwnym
+ *         przypadku lub gdy wskaźnik @p it ma wartość NULL.
+ */
+bool phfwdReverseIterFailed(struct PhoneReverseIter const *it);
+
+/** @brief Usuwa iterator.
+ * Nic nie robi, jeśli wskaźnik @p it ma wartość NULL.
+ * @param[in] it – wskaźnik na usuwany iterator.
+ */
+void phfwdReverseIterDelete(struct PhoneReverseIter *it);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -97,6 +324,21 @@ struct PhoneNumbers const * phfwdReverse(struct PhoneForward *pf, char const *nu
  */
 void phnumDelete(struct PhoneNumbers const *pnum);
 
+/** @brief Scala posortowane ciągi numerów.
+ * Tworzy ciąg numerów występujących w którymkolwiek z ciągów @p lists,
+ * posortowany leksykograficznie i bez powtórzeń. Każdy z ciągów musi być
+ * posortowany leksykograficznie. Wskaźniki NULL w tablicy @p lists oznaczają
+ * puste ciągi. Alokuje strukturę @p PhoneNumbers, która musi być zwolniona
+ * za pomocą funkcji @ref phnumDelete.
+ * @param[in] lists – tablica scalanych ciągów;
+ * @param[in] n     – długość tablicy @p lists.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         tablica @p lists ma wartość NULL przy niezerowym @p n lub nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phnumMerge(struct PhoneNumbers const *const *lists,
+                                       size_t n);
+
 /** @brief Udostępnia numer.
  * Udostępnia wskaźnik na napis reprezentujący numer. Napisy są indeksowane
  * kolejno od zera.
@@ -125,4 +367,226 @@ char const * phnumGet(struct PhoneNumbers const *pnum, size_t idx);
  */
 size_t phfwdNonTrivialCount(struct PhoneForward *pf, char const *set, size_t len);
 
+/** @brief Wyznacza liczbę nietrywialnych numerów pasujących do wzorca.
+ * Wzorzec określa osobny zbiór dozwolonych cyfr dla każdej pozycji numeru.
+ * Funkcja oblicza liczbę nietrywialnych numerów (patrz
+ * @ref phfwdNonTrivialCount) długości @p len, których i-ta cyfra znajduje
+ * się w napisie @p sets[i]. Jeśli wskaźnik @p pf lub @p sets ma wartość NULL,
+ * parametr len jest równy zeru lub nie udało się zaalokować pamięci, wynikiem
+ * jest zero. Wynik jest zwracany modulo dwa do potęgi liczba bitów
+ * reprezentacji typu size_t.
+ *
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[in] sets - tablica @p len napisów pełniących funkcję zbiorów cyfr
+ *                   dozwolonych na kolejnych pozycjach; wartość NULL oznacza
+ *                   zbiór pusty;
+ * @param[in] len  - długość numerów.
+ *
+ * @return Liczba nietrywialnych numerów pasujących do wzorca.
+ */
+size_t phfwdNonTrivialCountPattern(struct PhoneForward *pf,
+                                   char const *const *sets, size_t len);
+
+/** @brief Wyznacza liczby nietrywialnych numerów dla wielu długości i zbiorów
+ * cyfr naraz.
+ * Dla każdego zbioru @p sets[i] i każdej długości @p lens[j] wyznacza ten sam
+ * wynik co @ref phfwdNonTrivialCount, w jednym przejściu po wszystkich
+ * długościach słów, na które istnieją przekierowania.
+ *
+ * @param[in] pf       – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] sets     - tablica napisów pełniących funkcję zbiorów cyfr;
+ * @param[in] setCount - długość tablicy @p sets;
+ * @param[in] lens     - tablica długości numerów;
+ * @param[in] lenCount - długość tablicy @p lens;
+ * @param[out] out     - tablica na @p setCount * @p lenCount wyników; wynik dla
+ *                       @p sets[i] i @p lens[j] trafia na pozycję
+ *                       i * @p lenCount + j.
+ *
+ * @return Wartość @p true, jeśli wyniki zostały wyznaczone. Wartość @p false,
+ *         jeśli wskaźnik @p pf ma wartość NULL, potrzebna tablica ma wartość
+ *         NULL lub nie udało się zaalokować pamięci.
+ */
+bool phfwdNonTrivialCountBatch(struct PhoneForward *pf, char const *const *sets,
+                               size_t setCount, size_t const *lens,
+                               size_t lenCount, size_t *out);
+
+/** @brief Tworzy migawkę struktury.
+ * Migawka pozwala wyszukiwać przekierowania w stanie struktury z chwili jej
+ * utworzenia, podczas gdy struktura jest dalej zmieniana. Utworzenie migawki
+ * nie kopiuje drzew przekierowań; dopóki istnieje jakaś migawka, zmiany
+ * przekierowań są zapisywane w historii struktury. Po usunięciu struktury
+ * jej migawki pozostają unieważnione: zapytania do nich zwracają NULL, a
+ * można je jedynie usunąć.
+ * Zapytania do migawek mogą być wykonywane w innych wątkach współbieżnie
+ * ze zmianami struktury, ze sobą nawzajem i z usuwaniem innych migawek.
+ * Migawka korzysta jednak z drzew i historii struktury, które są zmieniane
+ * w miejscu, więc @ref phfwdAdd i @ref phfwdRemove czekają na zakończenie
+ * trwających zapytań do migawek. Pozostałe funkcje interfejsu, w tym
+ * tworzenie migawek, wywołujący musi szeregować ze zmianami struktury.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wskaźnik na migawkę lub NULL, gdy wskaźnik @p pf ma wartość NULL
+ *         lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForwardSnapshot * phfwdSnapshot(struct PhoneForward *pf);
+
+/** @brief Usuwa migawkę.
+ * Nic nie robi, jeśli wskaźnik @p snap ma wartość NULL. Po usunięciu
+ * najstarszej migawki struktury z historii zmian są usuwane zmiany, których
+ * nie potrzebują pozostałe migawki, a po usunięciu ostatniej migawki cała
+ * historia jest zwalniana.
+ * @param[in] snap – wskaźnik na usuwaną migawkę.
+ */
+void phfwdSnapshotDelete(struct PhoneForwardSnapshot *snap);
+
+/** @brief Wyznacza przekierowanie numeru w migawce.
+ * Działa jak @ref phfwdGet dla stanu struktury z chwili utworzenia migawki.
+ * @param[in] snap – wskaźnik na migawkę;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         struktura migawki została usunięta lub nie udało się zaalokować
+ *         pamięci.
+ */
+struct PhoneNumbers const * phfwdSnapshotGet(
+	struct PhoneForwardSnapshot const *snap, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w migawce.
+ * Działa jak @ref phfwdReverse dla stanu struktury z chwili utworzenia
+ * migawki.
+ * @param[in] snap – wskaźnik na migawkę;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         struktura migawki została usunięta lub nie udało się zaalokować
+ *         pamięci.
+ */
+struct PhoneNumbers const * phfwdSnapshotReverse(
+	struct PhoneForwardSnapshot const *snap, char const *num);
+
+/** @brief Zapisuje strukturę do pliku w postaci zamrożonej.
+ * Zapisuje przekierowania w niezmiennej postaci bez wskaźników, którą
+ * @ref phfwdFrozenMap udostępnia zapytaniom bezpośrednio z pliku, bez
+ * wczytywania i przebudowy. Wierzchołki drzew leżą w porządku BFS, a etykiety
+ * i numery w ciągłych tablicach. Format ma numer wersji i jest zależny od
+ * kolejności bajtów komputera.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów;
+ * @param[in] fd – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli struktura została zapisana. Wartość
+ *         @p false, jeśli wskaźnik @p pf ma wartość NULL, struktura jest zbyt
+ *         duża dla formatu, nie udało się zaalokować pamięci lub zapis się nie
+ *         powiódł.
+ */
+bool phfwdFreeze(struct PhoneForward *pf, int fd);
+
+/** @brief Odwzorowuje w pamięci zamrożoną strukturę z pliku.
+ * Odwzorowuje cały plik zapisany przez @ref phfwdFreeze tylko do odczytu
+ * i sprawdza jego poprawność. Nie zmienia pozycji w pliku. Plik nie może się
+ * zmieniać, dopóki struktura nie zostanie usunięta.
+ * @param[in] fd – deskryptor pliku otwartego do odczytu.
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się odwzorować pliku,
+ *         plik nie zawiera poprawnej zamrożonej struktury w tej samej wersji
+ *         formatu lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForwardFrozen * phfwdFrozenMap(int fd);
+
+/** @brief Udostępnia zamrożoną strukturę leżącą w pamięci.
+ * Działa jak @ref phfwdFrozenMap dla danych wczytanych lub odwzorowanych
+ * przez wywołującego. Dane nie są kopiowane i muszą pozostać niezmienione,
+ * dopóki struktura nie zostanie usunięta.
+ * @param[in] data – wskaźnik na dane wyrównany do 8 bajtów;
+ * @param[in] size – rozmiar danych.
+ * @return Wskaźnik na strukturę lub NULL, gdy dane nie są poprawną zamrożoną
+ *         strukturą lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForwardFrozen * phfwdFrozenOpen(const void *data, size_t size);
+
+/** @brief Usuwa zamrożoną strukturę.
+ * Zwalnia odwzorowanie utworzone przez @ref phfwdFrozenMap. Nic nie robi,
+ * jeśli wskaźnik @p pf ma wartość NULL.
+ * @param[in] pf – wskaźnik na usuwaną strukturę.
+ */
+void phfwdFrozenDelete(struct PhoneForwardFrozen *pf);
+
+/** @brief Wyznacza przekierowanie numeru w zamrożonej strukturze.
+ * Działa jak @ref phfwdGet. Może być wywoływana współbieżnie przez wiele
+ * wątków.
+ * @param[in] pf  – wskaźnik na zamrożoną strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdFrozenGet(
+	struct PhoneForwardFrozen const *pf, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w zamrożonej strukturze.
+ * Działa jak @ref phfwdReverse. Może być wywoływana współbieżnie przez wiele
+ * wątków.
+ * @param[in] pf  – wskaźnik na zamrożoną strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdFrozenReverse(
+	struct PhoneForwardFrozen const *pf, char const *num);
+
+/** @brief Oblicza liczbę nietrywialnych numerów w zamrożonej strukturze.
+ * Działa jak @ref phfwdNonTrivialCount. Może być wywoływana współbieżnie
+ * przez wiele wątków.
+ * @param[in] pf  – wskaźnik na zamrożoną strukturę;
+ * @param[in] set - napis pełniący funkcję zbioru możliwych cyfr;
+ * @param[in] len - zadana długość nietrywialnych numerów.
+ * @return Liczba nietrywialnych numerów o zadanych własnościach.
+ */
+size_t phfwdFrozenNonTrivialCount(struct PhoneForwardFrozen const *pf,
+                                  char const *set, size_t len);
+
+/** @brief Tworzy zwięzłą kopię struktury.
+ * Koduje drzewa przekierowań w postaci LOUDS: kształt drzewa jako wektor bitów
+ * z operacjami rank i select, a etykiety jako jeden ciąg upakowanych cyfr.
+ * Kopia zajmuje kilka bajtów na wierzchołek zamiast kilkudziesięciu, ale
+ * zapytania do niej są wolniejsze. Późniejsze zmiany struktury @p pf nie są
+ * w niej widoczne.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                 numerów.
+ * @return Wskaźnik na kopię lub NULL, gdy wskaźnik @p pf ma wartość NULL,
+ *         struktura jest zbyt duża lub nie udało się zaalokować pamięci.
+ */
+struct PhoneForwardSuccinct * phfwdSuccinctNew(struct PhoneForward *pf);
+
+/** @brief Usuwa zwięzłą kopię struktury.
+ * Nic nie robi, jeśli wskaźnik @p pf ma wartość NULL.
+ * @param[in] pf – wskaźnik na usuwaną kopię.
+ */
+void phfwdSuccinctDelete(struct PhoneForwardSuccinct *pf);
+
+/** @brief Oblicza rozmiar zwięzłej kopii struktury.
+ * @param[in] pf – wskaźnik na kopię.
+ * @return Liczba bajtów pamięci zajmowanych przez kopię lub 0, jeśli wskaźnik
+ *         @p pf ma wartość NULL.
+ */
+size_t phfwdSuccinctSize(struct PhoneForwardSuccinct const *pf);
+
+/** @brief Wyznacza przekierowanie numeru w zwięzłej kopii struktury.
+ * Działa jak @ref phfwdGet. Może być wywoływana współbieżnie przez wiele
+ * wątków.
+ * @param[in] pf  – wskaźnik na kopię;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdSuccinctGet(
+	struct PhoneForwardSuccinct const *pf, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer w zwięzłej kopii struktury.
+ * Działa jak @ref phfwdReverse. Może być wywoływana współbieżnie przez wiele
+ * wątków.
+ * @param[in] pf  – wskaźnik na kopię;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdSuccinctReverse(
+	struct PhoneForwardSuccinct const *pf, char const *num);
+
 #endif /* __PHONE_FORWARD_H__ */
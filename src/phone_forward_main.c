@@ -6,23 +6,37 @@
  * @date 28.05.2018
  */
 
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "scanner.h"
 #include "phone_forward.h"
 #include "symbol_table.h"
 
+/**
+ * Rozszerzenie pliku, w którym polecenie SAVE zapisuje bazę o danej nazwie.
+ * Dzięki niemu polecenie nie nadpisuje plików o nazwach równych nazwom baz.
+ */
+#define BASE_FILE_SUFFIX ".phfwd"
+
 /**
  * Typ polecenia do wykonania przez interpreter.
  */
 enum commandType {
 	SWITCH, ///< Zmiana (i ew. utworzenie poprzez phfwdNew()) obecnej bazy.
 	DELETE, ///< Usunięcie bazy.
+	SAVE_BASE, ///< Zapisanie bazy do pliku NAZWA.phfwd przez phfwdSave().
+	LOAD_BASE, ///< Wczytanie bazy z pliku NAZWA.phfwd przez phfwdLoad()
+	           ///< i jej wybranie.
 	ADD, ///< Wywołanie phfwdAdd().
 	REMOVE, ///< Wywołanie phfwdRemove().
 	GET, ///< Wywołanie phfwdGet() i wypisanie wyniku.
 	REV, ///< Wywołanie phfwdReverse() i wypisanie wyniku.
 	COUNT, ///< Wywołanie phfwdReverse() i wypisanie wyniku.
+	PATTERN_COUNT, ///< Wywołanie phfwdNonTrivialCountPattern()
+	               ///< i wypisanie wyniku.
 	END, ///< Brak dalszych poleceń. Zakończenie programu.
 	OOM_ERROR, ///< Błąd alokacji wewnątrz parsera lub skanera.
 	EOF_ERROR, ///< Nieoczekiwany koniec danych.
@@ -42,9 +56,12 @@ get_op_name(enum commandType t)
 	case SWITCH: return "NEW";
 	case DELETE:
 	case REMOVE: return "DEL";
+	case SAVE_BASE: return "SAVE";
+	case LOAD_BASE: return "LOAD";
 	case GET:
 	case REV: return "?";
 	case COUNT: return "@";
+	case PATTERN_COUNT: return "%";
 	case ADD: return ">";
 	default: return "";
 	}
@@ -108,6 +125,23 @@ getCommand(struct command *out, size_t *count)
 			out->op_offset = t2.beg;
 		}
 		break;
+	case IDENT:
+		/* SAVE i LOAD są słowami kluczowymi tylko na początku polecenia,
+		 * więc nadal mogą być nazwami baz. */
+		out->op_offset = t.beg;
+		if (strcmp(t.string, "SAVE") && strcmp(t.string, "LOAD")) {
+			out->type = SYNTAX_ERROR;
+			break;
+		}
+		out->type = strcmp(t.string, "SAVE") ? LOAD_BASE : SAVE_BASE;
+		free(t.string);
+		getToken(&t2, count);
+		out->operand1 = t2.string;
+		if (t2.type != IDENT) {
+			out->type = t2.type == OOM_TOKEN ? OOM_ERROR : SYNTAX_ERROR;
+			out->op_offset = t2.beg;
+		}
+		break;
 	case OP_QUERY:
 		out->op_offset = t.beg;
 		getToken(&t2, count);
@@ -130,6 +164,17 @@ getCommand(struct command *out, size_t *count)
 			out->op_offset = t2.beg;
 		}
 		break;
+	case OP_PATTERN:
+		out->op_offset = t.beg;
+		getPatternToken(&t2, count);
+		out->operand1 = t2.string;
+		if (t2.type == PATTERN) {
+			out->type = PATTERN_COUNT;
+		} else {
+			out->type = t2.type == OOM_TOKEN ? OOM_ERROR : SYNTAX_ERROR;
+			out->op_offset = t2.beg;
+		}
+		break;
 	case NUMBER:
 		getToken(&t2, count);
 		out->op_offset = t2.beg;
@@ -162,6 +207,100 @@ getCommand(struct command *out, size_t *count)
 	return;
 }
 
+/**
+ * @brief Wywołuje phfwdNonTrivialCountPattern() dla wzorca zapisanego jako
+ * zbiory cyfr kolejnych pozycji oddzielone przecinkami.
+ * Zamienia przecinki we wzorcu na znaki '\0'.
+ *
+ * @param pf Baza.
+ * @param pattern Wzorzec.
+ * @param[out] result Wynik.
+ *
+ * @return true, jeśli się udało, lub false w przypadku błędu alokacji.
+ */
+static bool
+countPattern(struct PhoneForward *pf, char *pattern, size_t *result)
+{
+	size_t len = 1;
+	for (char *c = pattern; *c; ++c)
+		len += *c == ',';
+	char **sets = malloc(len * sizeof(char*));
+	if (!sets) return false;
+	sets[0] = pattern;
+	len = 1;
+	for (char *c = pattern; *c; ++c) {
+		if (*c == ',') {
+			*c = '\0';
+			sets[len++] = c + 1;
+		}
+	}
+	*result = phfwdNonTrivialCountPattern(pf, (char const *const *)sets,
+	                                      len);
+	free(sets);
+	return true;
+}
+
+/**
+ * @brief Wyznacza nazwę pliku, w którym jest zapisywana baza.
+ *
+ * @param name Nazwa bazy.
+ *
+ * @return Nazwa pliku zaalokowana przez malloc() lub NULL w przypadku błędu
+ * alokacji.
+ */
+static char *
+baseFile(const char *name)
+{
+	size_t len = strlen(name);
+	char *ret = malloc(len + sizeof(BASE_FILE_SUFFIX));
+	if (!ret) return NULL;
+	memcpy(ret, name, len);
+	memcpy(ret + len, BASE_FILE_SUFFIX, sizeof(BASE_FILE_SUFFIX));
+	return ret;
+}
+
+/**
+ * @brief Zapisuje bazę do pliku w bieżącym katalogu o nazwie wyznaczonej
+ * przez baseFile(), zastępując jego zawartość.
+ *
+ * @param pf Baza.
+ * @param name Nazwa bazy.
+ *
+ * @return true, jeśli się udało, lub false w przeciwnym przypadku.
+ */
+static bool
+saveBase(struct PhoneForward *pf, const char *name)
+{
+	char *file = baseFile(name);
+	if (!file) return false;
+	int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	free(file);
+	if (fd < 0) return false;
+	bool ret = phfwdSave(pf, fd);
+	return close(fd) == 0 && ret;
+}
+
+/**
+ * @brief Wczytuje bazę z pliku w bieżącym katalogu o nazwie wyznaczonej
+ * przez baseFile().
+ *
+ * @param name Nazwa bazy.
+ *
+ * @return Wczytana baza lub NULL w przypadku błędu.
+ */
+static struct PhoneForward *
+loadBase(const char *name)
+{
+	char *file = baseFile(name);
+	if (!file) return NULL;
+	int fd = open(file, O_RDONLY);
+	free(file);
+	if (fd < 0) return NULL;
+	struct PhoneForward *ret = phfwdLoad(fd);
+	close(fd);
+	return ret;
+}
+
 /**
  * @brief Usuwa bazę. Wrapper na phfwdDelete().
  *
@@ -223,6 +362,25 @@ int main()
 			} else {
 				status = ERROR;
 			}
+		} else if (cmd.type == SAVE_BASE) {
+			struct PhoneForward *target = getSymbol(table, cmd.operand1);
+			if (!target || !saveBase(target, cmd.operand1))
+				status = ERROR;
+		} else if (cmd.type == LOAD_BASE) {
+			struct PhoneForward *loaded = loadBase(cmd.operand1);
+			struct PhoneForward *target = getSymbol(table, cmd.operand1);
+			if (loaded && target) {
+				if (target == current)
+					current = NULL;
+				phfwdDelete(target);
+				removeSymbol(table, cmd.operand1);
+			}
+			if (loaded && addSymbol(table, cmd.operand1, loaded)) {
+				current = loaded;
+			} else {
+				phfwdDelete(loaded);
+				status = ERROR;
+			}
 		} else if (!current) {
 			status = ERROR;
 		} else if (cmd.type == ADD) {
@@ -242,15 +400,23 @@ int main()
 			size_t result = phfwdNonTrivialCount(current, cmd.operand1,
 					len > 12 ? len - 12: 0);
 			printf("%zu\n", result);
+		} else if (cmd.type == PATTERN_COUNT) {
+			size_t result;
+			if (countPattern(current, cmd.operand1, &result))
+				printf("%zu\n", result);
+			else
+				status = ERROR;
 		} else if (cmd.type == REV) {
-			pn = phfwdReverse(current, cmd.operand1);
-			const char *num = phnumGet(pn, 0);
-			if (num) {
-				for (int i = 0; (num = phnumGet(pn, i)); ++i)
-					puts(num);
-			} else {
+			struct PhoneReverseIter *it = phfwdReverseIterNew(current,
+					cmd.operand1);
+			const char *num = phfwdReverseIterNext(it);
+			if (!num)
 				status = ERROR;
-			}
+			for (; num; num = phfwdReverseIterNext(it))
+				puts(num);
+			if (phfwdReverseIterFailed(it))
+				status = ERROR;
+			phfwdReverseIterDelete(it);
 		}	
 		free(cmd.operand1);
 		free(cmd.operand2);
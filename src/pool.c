@@ -0,0 +1,166 @@
+/** @file
+ * Implementacja puli wątków wykonującej niezależne zadania.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "pool.h"
+
+/**
+ * Pula wątków roboczych. Wątki czekają na zmianę numeru zlecenia, wykonują
+ * jego zadania i zgłaszają zakończenie.
+ */
+struct Pool {
+	pthread_mutex_t run; ///< Szereguje wywołania poolRun().
+	pthread_mutex_t lock; ///< Chroni pola zlecenia i licznik @p busy.
+	pthread_cond_t wake; ///< Sygnalizuje nowe zlecenie lub zamykanie puli.
+	pthread_cond_t done; ///< Sygnalizuje zakończenie pracy przez wątki.
+	pthread_t *workers; ///< Wątki robocze.
+	unsigned count; ///< Liczba wątków roboczych.
+	unsigned busy; ///< Liczba wątków roboczych pracujących nad zleceniem.
+	unsigned long round; ///< Numer bieżącego zlecenia.
+	bool stop; ///< Czy wątki mają się zakończyć.
+	PoolTask task; ///< Funkcja wykonująca zadania zlecenia.
+	void *ctx; ///< Kontekst zlecenia.
+	size_t tasks; ///< Liczba zadań zlecenia.
+	atomic_size_t next; ///< Indeks następnego zadania do pobrania.
+};
+
+/**
+ * @brief Wykonuje zadania bieżącego zlecenia, dopóki jakieś zostały.
+ *
+ * @param arg Pula.
+ */
+static void
+drain(struct Pool *arg)
+{
+	size_t idx;
+	while ((idx = atomic_fetch_add(&arg->next, 1)) < arg->tasks)
+		arg->task(arg->ctx, idx);
+}
+
+/**
+ * @brief Główna pętla wątku roboczego.
+ *
+ * @param ptr Pula.
+ *
+ * @return NULL.
+ */
+static void *
+workerMain(void *ptr)
+{
+	struct Pool *arg = ptr;
+	unsigned long seen = 0;
+	pthread_mutex_lock(&arg->lock);
+	while (true) {
+		while (!arg->stop && arg->round == seen)
+			pthread_cond_wait(&arg->wake, &arg->lock);
+		if (arg->stop)
+			break;
+		seen = arg->round;
+		pthread_mutex_unlock(&arg->lock);
+		drain(arg);
+		pthread_mutex_lock(&arg->lock);
+		if (--arg->busy == 0)
+			pthread_cond_signal(&arg->done);
+	}
+	pthread_mutex_unlock(&arg->lock);
+	return NULL;
+}
+
+/**
+ * @brief Kończy pierwsze @p count wątków puli i zwalnia ją.
+ *
+ * @param arg Pula.
+ * @param count Liczba uruchomionych wątków.
+ */
+static void
+poolShutdown(struct Pool *arg, unsigned count)
+{
+	pthread_mutex_lock(&arg->lock);
+	arg->stop = true;
+	pthread_cond_broadcast(&arg->wake);
+	pthread_mutex_unlock(&arg->lock);
+	for (unsigned i = 0; i < count; ++i)
+		pthread_join(arg->workers[i], NULL);
+	pthread_cond_destroy(&arg->done);
+	pthread_cond_destroy(&arg->wake);
+	pthread_mutex_destroy(&arg->lock);
+	pthread_mutex_destroy(&arg->run);
+	free(arg->workers);
+	free(arg);
+}
+
+struct Pool *
+poolNew(unsigned threads)
+{
+	if (threads < 2) return NULL;
+	struct Pool *new = malloc(sizeof(struct Pool));
+	if (!new) return NULL;
+	new->count = threads - 1;
+	new->workers = malloc(new->count * sizeof(pthread_t));
+	if (!new->workers) {
+		free(new);
+		return NULL;
+	}
+	pthread_mutex_init(&new->run, NULL);
+	pthread_mutex_init(&new->lock, NULL);
+	pthread_cond_init(&new->wake, NULL);
+	pthread_cond_init(&new->done, NULL);
+	new->busy = 0;
+	new->round = 0;
+	new->stop = false;
+	new->task = NULL;
+	new->ctx = NULL;
+	new->tasks = 0;
+	atomic_init(&new->next, 0);
+	for (unsigned i = 0; i < new->count; ++i) {
+		if (pthread_create(&new->workers[i], NULL, workerMain, new)) {
+			poolShutdown(new, i);
+			return NULL;
+		}
+	}
+	return new;
+}
+
+void
+poolDelete(struct Pool *arg)
+{
+	if (arg)
+		poolShutdown(arg, arg->count);
+}
+
+unsigned
+poolSize(const struct Pool *arg)
+{
+	return arg->count + 1;
+}
+
+void
+poolRun(struct Pool *arg, PoolTask task, void *ctx, size_t count)
+{
+	pthread_mutex_lock(&arg->run);
+	pthread_mutex_lock(&arg->lock);
+	arg->task = task;
+	arg->ctx = ctx;
+	arg->tasks = count;
+	atomic_store(&arg->next, 0);
+	arg->busy = arg->count;
+	++arg->round;
+	pthread_cond_broadcast(&arg->wake);
+	pthread_mutex_unlock(&arg->lock);
+
+	drain(arg);
+
+	pthread_mutex_lock(&arg->lock);
+	while (arg->busy > 0)
+		pthread_cond_wait(&arg->done, &arg->lock);
+	pthread_mutex_unlock(&arg->lock);
+	pthread_mutex_unlock(&arg->run);
+}
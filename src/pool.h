@@ -0,0 +1,67 @@
+/** @file
+ * Interfejs puli wątków wykonującej niezależne zadania.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef POOL_H
+#define POOL_H
+#include <stddef.h>
+
+/**
+ * Pula wątków roboczych.
+ */
+struct Pool;
+
+/**
+ * @brief Funkcja wykonująca zadanie.
+ *
+ * @param ctx Kontekst przekazany do poolRun().
+ * @param idx Indeks zadania.
+ */
+typedef void (*PoolTask)(void *ctx, size_t idx);
+
+/**
+ * @brief Tworzy pulę wątków.
+ *
+ * @param threads Łączna liczba wątków wykonujących zadania, wliczając wątek
+ * wywołujący poolRun(). Musi być większa od 1.
+ *
+ * @return Wskaźnik na pulę lub NULL, jeśli nie udało się zaalokować pamięci
+ * lub utworzyć wątków.
+ */
+struct Pool * poolNew(unsigned threads);
+
+/**
+ * @brief Kończy wątki puli i zwalnia ją.
+ * Nic nie robi, jeśli @p arg ma wartość NULL.
+ *
+ * @param arg Pula.
+ */
+void poolDelete(struct Pool *arg);
+
+/**
+ * @brief Zwraca łączną liczbę wątków wykonujących zadania.
+ *
+ * @param arg Pula.
+ */
+unsigned poolSize(const struct Pool *arg);
+
+/**
+ * @brief Wykonuje zadania o indeksach od 0 do @p count - 1 i czeka na ich
+ * zakończenie.
+ * Wątki, w tym wywołujący, pobierają kolejne zadania ze wspólnego licznika,
+ * więc zadania powinny być drobniejsze niż podział na liczbę wątków, żeby
+ * nierówne zadania rozłożyły się równomiernie. Wywołania z różnych wątków
+ * są wykonywane po kolei.
+ *
+ * @param arg Pula.
+ * @param task Funkcja wykonująca zadanie.
+ * @param ctx Kontekst przekazywany do @p task.
+ * @param count Liczba zadań.
+ */
+void poolRun(struct Pool *arg, PoolTask task, void *ctx, size_t count);
+
+#endif
@@ -92,8 +92,25 @@ isDigit(int c)
 	return c >= '0' && c <= ';';
 }
 
-void
-getToken(struct token *out, size_t *count)
+/**
+ * @brief Sprawdza czy podany znak może należeć do wzorca.
+ *
+ * @param c Dany znak.
+ */
+static int
+isPatternChar(int c)
+{
+	return isDigit(c) || c == ',';
+}
+
+/** @brief Wspólna implementacja getToken() i getPatternToken().
+ *
+ * @param[out] out Zwracany token.
+ * @param[in,out] count Wskaźnik na licznik wczytanych dotychczas znaków.
+ * @param pattern Czy ciągi cyfr i przecinków są wczytywane jako PATTERN.
+ */
+static void
+scanToken(struct token *out, size_t *count, bool pattern)
 {
 	int c;
 	out->string = NULL;
@@ -120,6 +137,13 @@ getToken(struct token *out, size_t *count)
 		out->type = OP_QUERY;
 	} else if (c == '@') {
 		out->type = OP_COUNT;
+	} else if (c == '%') {
+		out->type = OP_PATTERN;
+	} else if (pattern && isPatternChar(c)) {
+		--*count; ungetc(c, stdin);
+		out->string = extractWord(isPatternChar, count);
+		out->type = out->string ? PATTERN : OOM_TOKEN;
+		return;
 	} else if (isDigit(c)) {
 		--*count; ungetc(c, stdin);
 		out->string = extractWord(isDigit, count);
@@ -147,3 +171,15 @@ getToken(struct token *out, size_t *count)
 	}
 	return;
 }
+
+void
+getToken(struct token *out, size_t *count)
+{
+	scanToken(out, count, false);
+}
+
+void
+getPatternToken(struct token *out, size_t *count)
+{
+	scanToken(out, count, true);
+}
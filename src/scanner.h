@@ -19,8 +19,10 @@ enum tokenType {
 	OP_QUERY, ///< "?"
 	OP_REDIR, ///< ">"
 	OP_COUNT, ///< "@"
-	IDENT, ///< "[a-zA-Z0-9]+"
+	OP_PATTERN, ///< "%"
+	IDENT, ///< "[a-zA-Z0-9]+", także "SAVE" i "LOAD"
 	NUMBER, ///< "[0-9]+
+	PATTERN, ///< "[0-9,]+", tylko z getPatternToken()
 	EOF_TOKEN, ///< "Koniec pliku."
 	UNKNOWN, ///< "Token nieprzewidziany w specyfikacji."
 	OOM_TOKEN, ///< "Błąd przy alokacji pamięci na wartość tokenu".
@@ -33,7 +35,7 @@ struct token {
 	/** Rodzaj tokenu. */
 	enum tokenType type;
 
-	/** Dla tokenów IDENT i NUMBER: tekst tokenu.
+	/** Dla tokenów IDENT, NUMBER i PATTERN: tekst tokenu.
 	 * Dla pozostałych rodzajów tokenów: NULL. */
 	char *string;
 
@@ -55,4 +57,14 @@ struct token {
  */
 void getToken(struct token *out, size_t *count);
 
+/** @brief Skaner tokenów, w którym ciągi cyfr mogą zawierać przecinki.
+ *
+ * Działa jak getToken(), ale ciąg znaków będących cyframi lub przecinkami
+ * zwraca jako jeden token PATTERN.
+ *
+ * @param[out] out Zwracany token.
+ * @param[in,out] count Wskaźnik na licznik wczytanych dotychczas znaków.
+ */
+void getPatternToken(struct token *out, size_t *count);
+
 #endif
@@ -0,0 +1,131 @@
+/** @file
+ * Implementacja bazy przekierowań podzielonej na niezależne części.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#include <pthread.h>
+#include "sharded.h"
+
+/** Liczba cyfr, czyli znaków od '0' do ';'. */
+#define DIGITS 12
+
+/**
+ * Część bazy wraz z blokadą.
+ */
+struct Shard {
+	pthread_mutex_t lock; ///< Chroni @p pf.
+	struct PhoneForward *pf; ///< Przekierowania należące do części.
+};
+
+/**
+ * Baza przekierowań podzielona na niezależne części.
+ */
+struct PhoneForwardSharded {
+	unsigned count; ///< Liczba części.
+	struct Shard shards[]; ///< Części.
+};
+
+/**
+ * @brief Wyznacza część, do której należy numer.
+ * Napisy niezaczynające się cyfrą trafiają do części 0, gdzie funkcje
+ * PhoneForward obsługują je jak każdą niepoprawną wartość.
+ *
+ * @param arg Baza.
+ * @param num Napis lub NULL.
+ */
+static struct Shard *
+shardOf(struct PhoneForwardSharded *arg, const char *num)
+{
+	if (!num || num[0] < '0' || num[0] >= '0' + DIGITS)
+		return &arg->shards[0];
+	return &arg->shards[(unsigned)(num[0] - '0') % arg->count];
+}
+
+struct PhoneForwardSharded *
+phfwdShardedNew(unsigned shards)
+{
+	if (shards == 0) shards = 1;
+	if (shards > DIGITS) shards = DIGITS;
+	struct PhoneForwardSharded *new = malloc(sizeof(struct PhoneForwardSharded)
+	                                         + shards * sizeof(struct Shard));
+	if (!new) return NULL;
+	new->count = shards;
+	for (unsigned i = 0; i < shards; ++i) {
+		new->shards[i].pf = phfwdNew();
+		if (!new->shards[i].pf) {
+			new->count = i;
+			phfwdShardedDelete(new);
+			return NULL;
+		}
+		pthread_mutex_init(&new->shards[i].lock, NULL);
+	}
+	return new;
+}
+
+void
+phfwdShardedDelete(struct PhoneForwardSharded *pf)
+{
+	if (!pf) return;
+	for (unsigned i = 0; i < pf->count; ++i) {
+		phfwdDelete(pf->shards[i].pf);
+		pthread_mutex_destroy(&pf->shards[i].lock);
+	}
+	free(pf);
+}
+
+bool
+phfwdShardedAdd(struct PhoneForwardSharded *pf, char const *num1,
+                char const *num2)
+{
+	if (!pf) return false;
+	struct Shard *shard = shardOf(pf, num1);
+	pthread_mutex_lock(&shard->lock);
+	bool ret = phfwdAdd(shard->pf, num1, num2);
+	pthread_mutex_unlock(&shard->lock);
+	return ret;
+}
+
+void
+phfwdShardedRemove(struct PhoneForwardSharded *pf, char const *num)
+{
+	if (!pf) return;
+	struct Shard *shard = shardOf(pf, num);
+	pthread_mutex_lock(&shard->lock);
+	phfwdRemove(shard->pf, num);
+	pthread_mutex_unlock(&shard->lock);
+}
+
+const struct PhoneNumbers *
+phfwdShardedGet(struct PhoneForwardSharded *pf, char const *num)
+{
+	if (!pf) return NULL;
+	struct Shard *shard = shardOf(pf, num);
+	pthread_mutex_lock(&shard->lock);
+	const struct PhoneNumbers *ret = phfwdGet(shard->pf, num);
+	pthread_mutex_unlock(&shard->lock);
+	return ret;
+}
+
+const struct PhoneNumbers *
+phfwdShardedReverse(struct PhoneForwardSharded *pf, char const *num)
+{
+	if (!pf) return NULL;
+	const struct PhoneNumbers *parts[DIGITS] = {NULL};
+	const struct PhoneNumbers *ret = NULL;
+	unsigned done = 0;
+	for (; done < pf->count; ++done) {
+		struct Shard *shard = &pf->shards[done];
+		pthread_mutex_lock(&shard->lock);
+		parts[done] = phfwdReverse(shard->pf, num);
+		pthread_mutex_unlock(&shard->lock);
+		if (!parts[done]) break;
+	}
+	if (done == pf->count)
+		ret = phnumMerge(parts, pf->count);
+	for (unsigned i = 0; i < done; ++i)
+		phnumDelete(parts[i]);
+	return ret;
+}
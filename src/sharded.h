@@ -0,0 +1,85 @@
+/** @file
+ * Interfejs bazy przekierowań podzielonej na niezależne części.
+ *
+ * Przekierowania są rozdzielane między części według pierwszej cyfry
+ * przekierowywanego prefiksu. Każda część ma własną strukturę PhoneForward
+ * i własną blokadę, więc zmiany dotyczące różnych części mogą być wykonywane
+ * równolegle przez różne wątki.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef SHARDED_H
+#define SHARDED_H
+#include "phone_forward.h"
+
+/**
+ * Baza przekierowań podzielona na niezależne części.
+ */
+struct PhoneForwardSharded;
+
+/** @brief Tworzy nową podzieloną bazę.
+ * Tworzy bazę niezawierającą żadnych przekierowań. Cyfra d trafia do części
+ * d mod @p shards, więc więcej niż 12 części nie ma sensu i liczba części
+ * jest do tej wartości ograniczana.
+ * @param[in] shards – liczba części; wartość 0 jest traktowana jak 1.
+ * @return Wskaźnik na utworzoną bazę lub NULL, gdy nie udało się
+ *         zaalokować pamięci.
+ */
+struct PhoneForwardSharded * phfwdShardedNew(unsigned shards);
+
+/** @brief Usuwa podzieloną bazę.
+ * Nic nie robi, jeśli wskaźnik @p pf ma wartość NULL. Żaden wątek nie może
+ * w tym czasie korzystać z bazy.
+ * @param[in] pf – wskaźnik na usuwaną bazę.
+ */
+void phfwdShardedDelete(struct PhoneForwardSharded *pf);
+
+/** @brief Dodaje przekierowanie.
+ * Działa jak @ref phfwdAdd. Blokuje tylko część, do której należy @p num1.
+ * @param[in] pf   – wskaźnik na bazę;
+ * @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
+ *                   przekierowywanych;
+ * @param[in] num2 – wskaźnik na napis reprezentujący prefiks numerów,
+ *                   na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+ *         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+ *         się zaalokować pamięci.
+ */
+bool phfwdShardedAdd(struct PhoneForwardSharded *pf, char const *num1,
+                     char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa jak @ref phfwdRemove. Blokuje tylko część, do której należy @p num.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+void phfwdShardedRemove(struct PhoneForwardSharded *pf, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa jak @ref phfwdGet. Wszystkie prefiksy numeru należą do tej samej
+ * części, więc przeszukiwana jest tylko ona.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdShardedGet(struct PhoneForwardSharded *pf,
+                                            char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa jak @ref phfwdReverse. Przeszukuje po kolei wszystkie części i scala
+ * ich posortowane wyniki. Zmiany wykonywane w tym czasie przez inne wątki
+ * mogą być uwzględnione tylko w części wyników.
+ * @param[in] pf  – wskaźnik na bazę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się zaalokować pamięci.
+ */
+struct PhoneNumbers const * phfwdShardedReverse(struct PhoneForwardSharded *pf,
+                                                char const *num);
+
+#endif
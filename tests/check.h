@@ -0,0 +1,126 @@
+/** @file
+ * Wspólne narzędzia testów: losowe skrypty operacji i porównywanie wyników.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "phone_forward.h"
+
+/** Maksymalna długość numeru w losowym skrypcie. */
+#define STEP_MAX_LENGTH 6
+
+/** Długość bufora na numer z losowego skryptu. */
+#define STEP_BUFFER (STEP_MAX_LENGTH + 1)
+
+/**
+ * Przerywa test z komunikatem, jeśli warunek nie jest spełniony. Nie korzysta
+ * z assert(), bo testy są budowane także z NDEBUG.
+ */
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: %s\n", \
+			        __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while (0)
+
+/**
+ * Operacja losowego skryptu.
+ */
+struct Step {
+	bool remove; ///< Czy jest to phfwdRemove(), a nie phfwdAdd().
+	char num1[STEP_BUFFER]; ///< Pierwszy argument.
+	char num2[STEP_BUFFER]; ///< Drugi argument, jeśli @p remove jest false.
+};
+
+/**
+ * @brief Losuje numer.
+ *
+ * @param[out] buf Bufor o rozmiarze co najmniej STEP_BUFFER.
+ * @param digits Liczba używanych cyfr, od 1 do 12.
+ */
+static inline void
+randomNumber(char *buf, unsigned digits)
+{
+	size_t len = 1 + rand() % STEP_MAX_LENGTH;
+	for (size_t i = 0; i < len; ++i)
+		buf[i] = '0' + rand() % digits;
+	buf[len] = '\0';
+}
+
+/**
+ * @brief Losuje skrypt operacji. Średnio co czwarta operacja jest
+ * usunięciem, zwykle krótkiego prefiksu, żeby usuwała istniejące
+ * przekierowania. Argumenty dodania są różne.
+ *
+ * @param[out] steps Tablica operacji.
+ * @param count Liczba operacji.
+ * @param digits Liczba używanych cyfr, od 1 do 12.
+ */
+static inline void
+randomScript(struct Step *steps, size_t count, unsigned digits)
+{
+	for (size_t i = 0; i < count; ++i) {
+		steps[i].remove = rand() % 4 == 0;
+		randomNumber(steps[i].num1, digits);
+		do {
+			randomNumber(steps[i].num2, digits);
+		} while (!strcmp(steps[i].num1, steps[i].num2));
+		if (steps[i].remove)
+			steps[i].num1[1 + rand() % 2] = '\0';
+	}
+}
+
+/**
+ * @brief Wykonuje skrypt na strukturze.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param steps Tablica operacji.
+ * @param count Liczba operacji.
+ */
+static inline void
+runScript(struct PhoneForward *pf, const struct Step *steps, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		if (steps[i].remove)
+			phfwdRemove(pf, steps[i].num1);
+		else
+			CHECK(phfwdAdd(pf, steps[i].num1, steps[i].num2));
+	}
+}
+
+/**
+ * @brief Porównuje dwa ciągi numerów i zwalnia je.
+ *
+ * @param a Pierwszy ciąg.
+ * @param b Drugi ciąg.
+ *
+ * @return true, jeśli ciągi są równe.
+ */
+static inline bool
+sameNumbers(const struct PhoneNumbers *a, const struct PhoneNumbers *b)
+{
+	bool ret = a && b;
+	for (size_t i = 0; ret; ++i) {
+		const char *x = phnumGet(a, i), *y = phnumGet(b, i);
+		if (!x || !y) {
+			ret = x == y;
+			break;
+		}
+		ret = !strcmp(x, y);
+	}
+	phnumDelete(a);
+	phnumDelete(b);
+	return ret;
+}
+
+#endif
@@ -0,0 +1,329 @@
+/** @file
+ * Test różnicowy struktur pochodnych: wyniki migawek, bazy współdzielonej,
+ * bazy podzielonej, wstawiania hurtowego, zapytań wsadowych, iteratora,
+ * struktury zamrożonej i zwięzłej kopii są porównywane z wynikami
+ * phfwdGet(), phfwdReverse() i phfwdNonTrivialCount() dla tej samej bazy.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+/** Udostępnia fileno(). */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <unistd.h>
+#include "check.h"
+#include "concurrent.h"
+#include "sharded.h"
+
+/** Liczba losowych skryptów. */
+#define SCRIPTS 150
+
+/** Maksymalna liczba operacji w skrypcie. */
+#define STEPS 200
+
+/** Liczba zapytań porównujących struktury. */
+#define QUERIES 60
+
+/** Rozmiar strony wyników phfwdReverseLimit(). */
+#define PAGE 3
+
+/** Wszystkie cyfry; zbiór pierwszych k cyfr to prefiks tego napisu. */
+static const char ALL_DIGITS[] = "0123456789:;";
+
+/**
+ * Losowy skrypt i baza, na której go wykonano.
+ */
+struct Case {
+	struct PhoneForward *pf; ///< Baza po wykonaniu skryptu.
+	const struct Step *steps; ///< Skrypt.
+	size_t count; ///< Liczba operacji skryptu.
+	unsigned digits; ///< Liczba używanych cyfr.
+	char set[sizeof(ALL_DIGITS)]; ///< Zbiór używanych cyfr.
+};
+
+/**
+ * @brief Porównuje wyniki iteratora, phfwdReverseCount()
+ * i phfwdReverseLimit() z wynikiem phfwdReverse().
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ * @param num Numer.
+ */
+static void
+checkIter(struct PhoneForward *pf, const char *num)
+{
+	const struct PhoneNumbers *expected = phfwdReverse(pf, num);
+	CHECK(expected);
+	struct PhoneReverseIter *it = phfwdReverseIterNew(pf, num);
+	CHECK(it);
+	size_t size = 0;
+	for (const char *next; (next = phfwdReverseIterNext(it)); ++size) {
+		const char *want = phnumGet(expected, size);
+		CHECK(want && !strcmp(next, want));
+	}
+	CHECK(!phnumGet(expected, size));
+	phfwdReverseIterDelete(it);
+	CHECK(phfwdReverseCount(pf, num) == size);
+
+	size_t done = 0;
+	const char *after = NULL;
+	const struct PhoneNumbers *page = NULL;
+	while (1) {
+		const struct PhoneNumbers *next =
+			phfwdReverseLimit(pf, num, PAGE, after);
+		CHECK(next);
+		phnumDelete(page);
+		page = next;
+		size_t i = 0;
+		for (; phnumGet(page, i); ++i, ++done) {
+			const char *want = phnumGet(expected, done);
+			CHECK(want && !strcmp(phnumGet(page, i), want));
+		}
+		if (i < PAGE) break;
+		after = phnumGet(page, i - 1);
+	}
+	CHECK(done == size);
+	phnumDelete(page);
+	phnumDelete(expected);
+}
+
+/**
+ * @brief Porównuje zapytania wsadowe z pojedynczymi.
+ *
+ * @param c Przypadek testowy.
+ */
+static void
+checkBatch(const struct Case *c)
+{
+	char nums[QUERIES][STEP_BUFFER];
+	const char *ptrs[QUERIES];
+	for (size_t i = 0; i < QUERIES; ++i) {
+		randomNumber(nums[i], c->digits);
+		ptrs[i] = nums[i];
+	}
+	const struct PhoneNumbers *batch = phfwdGetBatch(c->pf, ptrs, QUERIES);
+	const struct PhoneNumbers *many = phfwdGetMany(c->pf, ptrs, QUERIES);
+	CHECK(batch && many);
+	for (size_t i = 0; i < QUERIES; ++i) {
+		const struct PhoneNumbers *single = phfwdGet(c->pf, ptrs[i]);
+		CHECK(single);
+		CHECK(!strcmp(phnumGet(batch, i), phnumGet(single, 0)));
+		CHECK(!strcmp(phnumGet(many, i), phnumGet(single, 0)));
+		phnumDelete(single);
+		checkIter(c->pf, ptrs[i]);
+	}
+	phnumDelete(batch);
+	phnumDelete(many);
+
+	const char *sets[2] = {c->set, "0"};
+	size_t lens[STEP_MAX_LENGTH];
+	size_t out[2 * STEP_MAX_LENGTH];
+	const char *pattern[STEP_MAX_LENGTH];
+	for (size_t i = 0; i < STEP_MAX_LENGTH; ++i) {
+		lens[i] = i + 1;
+		pattern[i] = c->set;
+	}
+	CHECK(phfwdNonTrivialCountBatch(c->pf, sets, 2, lens, STEP_MAX_LENGTH,
+	                                out));
+	for (size_t i = 0; i < 2; ++i) {
+		for (size_t j = 0; j < STEP_MAX_LENGTH; ++j) {
+			CHECK(out[i * STEP_MAX_LENGTH + j]
+			      == phfwdNonTrivialCount(c->pf, sets[i], lens[j]));
+		}
+	}
+	for (size_t len = 1; len <= STEP_MAX_LENGTH; ++len) {
+		CHECK(phfwdNonTrivialCountPattern(c->pf, pattern, len)
+		      == phfwdNonTrivialCount(c->pf, c->set, len));
+	}
+}
+
+/**
+ * @brief Porównuje bazę współdzieloną i podzieloną z bazą zwykłą.
+ *
+ * @param c Przypadek testowy.
+ */
+static void
+checkShared(const struct Case *c)
+{
+	struct PhoneForwardShared *shared = phfwdSharedNew();
+	struct PhoneForwardSharded *sharded = phfwdShardedNew(4);
+	CHECK(shared && sharded);
+	for (size_t i = 0; i < c->count; ++i) {
+		const struct Step *s = &c->steps[i];
+		if (s->remove) {
+			CHECK(phfwdSharedRemove(shared, s->num1));
+			phfwdShardedRemove(sharded, s->num1);
+		} else {
+			CHECK(phfwdSharedAdd(shared, s->num1, s->num2));
+			CHECK(phfwdShardedAdd(sharded, s->num1, s->num2));
+		}
+	}
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, c->digits);
+		CHECK(sameNumbers(phfwdSharedGet(shared, num),
+		                  phfwdGet(c->pf, num)));
+		CHECK(sameNumbers(phfwdSharedReverse(shared, num),
+		                  phfwdReverse(c->pf, num)));
+		CHECK(sameNumbers(phfwdShardedGet(sharded, num),
+		                  phfwdGet(c->pf, num)));
+		CHECK(sameNumbers(phfwdShardedReverse(sharded, num),
+		                  phfwdReverse(c->pf, num)));
+		size_t len = 1 + i % STEP_MAX_LENGTH;
+		CHECK(phfwdSharedNonTrivialCount(shared, c->set, len)
+		      == phfwdNonTrivialCount(c->pf, c->set, len));
+	}
+	phfwdSharedDelete(shared);
+	phfwdShardedDelete(sharded);
+}
+
+/**
+ * @brief Porównuje wstawianie hurtowe, także równoległe, z kolejnymi
+ * wywołaniami phfwdAdd() dla dodań ze skryptu.
+ *
+ * @param c Przypadek testowy.
+ */
+static void
+checkBulk(const struct Case *c)
+{
+	const char **pairs = malloc((2 * c->count + 1) * sizeof(char*));
+	struct PhoneForward *serial = phfwdNew();
+	struct PhoneForward *bulk = phfwdNew();
+	struct PhoneForward *parallel = phfwdNew();
+	CHECK(pairs && serial && bulk && parallel);
+	CHECK(phfwdSetThreads(parallel, 2));
+	size_t n = 0;
+	for (size_t i = 0; i < c->count; ++i) {
+		if (c->steps[i].remove) continue;
+		pairs[2 * n] = c->steps[i].num1;
+		pairs[2 * n + 1] = c->steps[i].num2;
+		CHECK(phfwdAdd(serial, pairs[2 * n], pairs[2 * n + 1]));
+		++n;
+	}
+	CHECK(phfwdAddBulk(bulk, pairs, n));
+	CHECK(phfwdAddBulk(parallel, pairs, n));
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, c->digits);
+		CHECK(sameNumbers(phfwdGet(bulk, num), phfwdGet(serial, num)));
+		CHECK(sameNumbers(phfwdReverse(bulk, num),
+		                  phfwdReverse(serial, num)));
+		CHECK(sameNumbers(phfwdGet(parallel, num),
+		                  phfwdGet(serial, num)));
+		CHECK(sameNumbers(phfwdReverse(parallel, num),
+		                  phfwdReverse(serial, num)));
+		size_t len = 1 + i % STEP_MAX_LENGTH;
+		size_t count = phfwdNonTrivialCount(serial, c->set, len);
+		CHECK(phfwdNonTrivialCount(bulk, c->set, len) == count);
+		CHECK(phfwdNonTrivialCount(parallel, c->set, len) == count);
+	}
+	phfwdDelete(serial);
+	phfwdDelete(bulk);
+	phfwdDelete(parallel);
+	free(pairs);
+}
+
+/**
+ * @brief Porównuje migawkę zrobioną w połowie skryptu z kopią bazy z tej
+ * samej chwili, a następnie bazę z kopią, na której wykonano resztę skryptu.
+ *
+ * @param c Przypadek testowy.
+ */
+static void
+checkSnapshot(const struct Case *c)
+{
+	size_t half = c->count / 2;
+	struct PhoneForward *pf = phfwdNew();
+	CHECK(pf);
+	runScript(pf, c->steps, half);
+	struct PhoneForward *copy = phfwdCopy(pf);
+	struct PhoneForwardSnapshot *old = phfwdSnapshot(pf);
+	CHECK(copy && old);
+	runScript(pf, c->steps + half, (c->count - half) / 2);
+	struct PhoneForwardSnapshot *mid = phfwdSnapshot(pf);
+	CHECK(mid);
+	runScript(pf, c->steps + half + (c->count - half) / 2,
+	          c->count - half - (c->count - half) / 2);
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, c->digits);
+		CHECK(sameNumbers(phfwdSnapshotGet(old, num),
+		                  phfwdGet(copy, num)));
+		CHECK(sameNumbers(phfwdSnapshotReverse(old, num),
+		                  phfwdReverse(copy, num)));
+	}
+	/* Po usunięciu najstarszej migawki historia jest przycinana,
+	 * a późniejsza nadal musi widzieć swój stan. */
+	phfwdSnapshotDelete(old);
+	runScript(copy, c->steps + half, (c->count - half) / 2);
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, c->digits);
+		CHECK(sameNumbers(phfwdSnapshotGet(mid, num),
+		                  phfwdGet(copy, num)));
+		CHECK(sameNumbers(phfwdSnapshotReverse(mid, num),
+		                  phfwdReverse(copy, num)));
+		CHECK(sameNumbers(phfwdGet(pf, num), phfwdGet(c->pf, num)));
+		CHECK(sameNumbers(phfwdReverse(pf, num),
+		                  phfwdReverse(c->pf, num)));
+	}
+	phfwdSnapshotDelete(mid);
+	phfwdDelete(copy);
+	phfwdDelete(pf);
+}
+
+/**
+ * @brief Porównuje strukturę zamrożoną i zwięzłą kopię z bazą.
+ *
+ * @param c Przypadek testowy.
+ */
+static void
+checkFrozen(const struct Case *c)
+{
+	FILE *file = tmpfile();
+	CHECK(file);
+	CHECK(phfwdFreeze(c->pf, fileno(file)));
+	struct PhoneForwardFrozen *frozen = phfwdFrozenMap(fileno(file));
+	struct PhoneForwardSuccinct *succinct = phfwdSuccinctNew(c->pf);
+	CHECK(frozen && succinct);
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, c->digits);
+		CHECK(sameNumbers(phfwdFrozenGet(frozen, num),
+		                  phfwdGet(c->pf, num)));
+		CHECK(sameNumbers(phfwdFrozenReverse(frozen, num),
+		                  phfwdReverse(c->pf, num)));
+		CHECK(sameNumbers(phfwdSuccinctGet(succinct, num),
+		                  phfwdGet(c->pf, num)));
+		CHECK(sameNumbers(phfwdSuccinctReverse(succinct, num),
+		                  phfwdReverse(c->pf, num)));
+		size_t len = 1 + i % STEP_MAX_LENGTH;
+		CHECK(phfwdFrozenNonTrivialCount(frozen, c->set, len)
+		      == phfwdNonTrivialCount(c->pf, c->set, len));
+	}
+	phfwdSuccinctDelete(succinct);
+	phfwdFrozenDelete(frozen);
+	fclose(file);
+}
+
+int main(void)
+{
+	static struct Step steps[STEPS];
+	srand(1);
+	for (size_t i = 0; i < SCRIPTS; ++i) {
+		struct Case c = {phfwdNew(), steps, rand() % STEPS,
+		                 2 + rand() % 11, ""};
+		CHECK(c.pf);
+		memcpy(c.set, ALL_DIGITS, c.digits);
+		randomScript(steps, c.count, c.digits);
+		runScript(c.pf, steps, c.count);
+		checkBatch(&c);
+		checkShared(&c);
+		checkBulk(&c);
+		checkSnapshot(&c);
+		checkFrozen(&c);
+		phfwdDelete(c.pf);
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+/** @file
+ * Test zapisu i odczytu bazy: phfwdLoad() musi odtworzyć każdą bazę zapisaną
+ * przez phfwdSave(), także po usunięciach przekierowań.
+ *
+ * @author Michał Chojnowski <mc394134@students.mimuw.edu.pl>
+ * @copyright Michał Chojnowski
+ * @date 17.10.2026
+ */
+
+/** Udostępnia fileno(). */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <unistd.h>
+#include "check.h"
+
+/** Liczba losowych skryptów. */
+#define SCRIPTS 300
+
+/** Maksymalna liczba operacji w skrypcie. */
+#define STEPS 200
+
+/** Liczba zapytań porównujących bazy. */
+#define QUERIES 100
+
+/**
+ * @brief Zapisuje bazę do pliku tymczasowego i wczytuje ją z powrotem.
+ *
+ * @param pf Struktura przechowująca przekierowania.
+ *
+ * @return Wczytana struktura.
+ */
+static struct PhoneForward *
+roundTrip(struct PhoneForward *pf)
+{
+	FILE *file = tmpfile();
+	CHECK(file);
+	CHECK(phfwdSave(pf, fileno(file)));
+	CHECK(lseek(fileno(file), 0, SEEK_SET) == 0);
+	struct PhoneForward *ret = phfwdLoad(fileno(file));
+	fclose(file);
+	CHECK(ret);
+	return ret;
+}
+
+/**
+ * @brief Sprawdza, czy dwie bazy dają te same wyniki.
+ *
+ * @param a Pierwsza baza.
+ * @param b Druga baza.
+ * @param digits Liczba używanych cyfr.
+ */
+static void
+compare(struct PhoneForward *a, struct PhoneForward *b, unsigned digits)
+{
+	for (size_t i = 0; i < QUERIES; ++i) {
+		char num[STEP_BUFFER];
+		randomNumber(num, digits);
+		CHECK(sameNumbers(phfwdGet(a, num), phfwdGet(b, num)));
+		CHECK(sameNumbers(phfwdReverse(a, num), phfwdReverse(b, num)));
+		size_t len = 1 + i % STEP_MAX_LENGTH;
+		CHECK(phfwdNonTrivialCount(a, "0123:;", len)
+		      == phfwdNonTrivialCount(b, "0123:;", len));
+	}
+}
+
+int main(void)
+{
+	struct PhoneForward *pf = phfwdNew();
+	CHECK(pf);
+	CHECK(phfwdAdd(pf, "123", "4"));
+	CHECK(phfwdAdd(pf, "124", "5"));
+	phfwdRemove(pf, "123");
+	phfwdRemove(pf, "124");
+	struct PhoneForward *copy = roundTrip(pf);
+	compare(pf, copy, 5);
+	phfwdDelete(copy);
+	phfwdDelete(pf);
+
+	static struct Step steps[STEPS];
+	srand(1);
+	for (size_t i = 0; i < SCRIPTS; ++i) {
+		unsigned digits = 2 + rand() % 11;
+		size_t count = rand() % STEPS;
+		randomScript(steps, count, digits);
+		pf = phfwdNew();
+		CHECK(pf);
+		runScript(pf, steps, count);
+		copy = roundTrip(pf);
+		compare(pf, copy, digits);
+		randomScript(steps, count, digits);
+		runScript(pf, steps, count);
+		runScript(copy, steps, count);
+		compare(pf, copy, digits);
+		phfwdDelete(copy);
+		phfwdDelete(pf);
+	}
+	return 0;
+}